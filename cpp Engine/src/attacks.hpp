@@ -2,6 +2,32 @@
 #include "bitboard.hpp"
 #include "turn.hpp"
 
+#ifdef CHESSLI_USE_PEXT
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Lookup data for the sliding attacks of one square.
+ *
+ * With magic bitboards the relevant occupancy is hashed by multiplying with a magic number,
+ * with PEXT (BMI2) the relevant occupancy bits are extracted directly. Either way the result
+ * indexes into this square's slice of the attack table.
+ */
+struct Magic {
+    Bitboard mask;
+    uint64_t magic;
+    Bitboard* attacks;
+    uint8_t shift;
+
+    unsigned index(const Bitboard occupied) const {
+#ifdef CHESSLI_USE_PEXT
+        return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
 struct AttackBitboards {
     static constexpr int KNIGHT_DIRECTIONS[8][2] = {
         { 1,  2}, { 2,  1}, { 2, -1}, { 1, -2},
@@ -11,6 +37,57 @@ struct AttackBitboards {
         { 1,  1}, { 1,  0}, { 1, -1}, { 0, -1},
         {-1, -1}, {-1,  0}, {-1,  1}, { 0,  1}
     };
+    static constexpr int BISHOP_DIRECTIONS[4][2] = {
+        { 1,  1}, { 1, -1}, {-1, -1}, {-1,  1}
+    };
+    static constexpr int ROOK_DIRECTIONS[4][2] = {
+        { 1,  0}, { 0,  1}, {-1,  0}, { 0, -1}
+    };
+    static constexpr uint64_t RANK_1 = 0xFFULL;
+    static constexpr uint64_t RANK_8 = 0xFFULL << 56;
+    static constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+    static constexpr uint64_t FILE_H = 0x0101010101010101ULL << 7;
+
+    // Magic multipliers, found offline by random trial against the masks built in init_magics.
+    // Each one maps every relevant occupancy of its square to a collision-free (or constructive)
+    // index in a table of 2^popcount(mask) entries.
+    static constexpr uint64_t BISHOP_MAGICS[64] = {
+        0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+        0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+        0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+        0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+        0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+        0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+        0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+        0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+        0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+        0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+        0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+        0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+        0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+        0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+        0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+        0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+    };
+    static constexpr uint64_t ROOK_MAGICS[64] = {
+        0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+        0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+        0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+        0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+        0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+        0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+        0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+        0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+        0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+        0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+        0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+        0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+        0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+        0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+        0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+        0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+    };
+
     static constexpr bool is_valid_fr(const int file, const int rank, int* sq) {
         *sq = rank * 8 + file;
         return (file >= 0 && file < 8 && rank >= 0 && rank < 8);
@@ -78,10 +155,97 @@ struct AttackBitboards {
         return mask;
     }
 
+    static Bitboard compute_line_through(const uint8_t sq1, const uint8_t sq2) {
+        if (sq1 == sq2) return Bitboard();
+        for (const auto* directions : {&BISHOP_DIRECTIONS, &ROOK_DIRECTIONS}) {
+            const Bitboard attacks = compute_sliding_attacks(sq1, Bitboard(), *directions);
+            if (attacks.covers(sq2)) {
+                return (attacks & compute_sliding_attacks(sq2, Bitboard(), *directions))
+                     | Bitboard(1ULL << sq1) | Bitboard(1ULL << sq2);
+            }
+        }
+        return Bitboard();
+    }
+
+    static Bitboard compute_sliding_attacks(const uint8_t sq, const Bitboard occupied, const int (&directions)[4][2]) {
+        const int rank = sq / 8;
+        const int file = sq % 8;
+        int new_rank, new_file, new_sq;
+        Bitboard attacks = Bitboard();
+
+        for (auto& dir : directions) {
+            new_rank = rank + dir[0];
+            new_file = file + dir[1];
+            while (is_valid_fr(new_file, new_rank, &new_sq)) {
+                attacks.add_square(new_sq);
+                if (occupied.covers(new_sq)) break;
+                new_rank += dir[0];
+                new_file += dir[1];
+            }
+        }
+        return attacks;
+    }
+
+    /**
+     * @brief Fills the magic lookup data and attack table for one slider type.
+     *
+     * Relevant occupancy masks exclude the board edges, since a blocker on the last square of a
+     * ray never changes the attacks. Every subset of the mask is enumerated and its attacks are
+     * stored at the index the magic (or PEXT) maps it to.
+     */
+    static void init_magics(Bitboard* table, Magic* magics, const uint64_t (&magic_numbers)[64], const int (&directions)[4][2]) {
+        Bitboard* next_attacks = table;
+
+        for (int sq = 0; sq < 64; ++sq) {
+            const uint64_t edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (8 * (sq / 8))))
+                                 | ((FILE_A | FILE_H) & ~(FILE_A << (sq % 8)));
+            Magic& m = magics[sq];
+            m.mask = compute_sliding_attacks(sq, Bitboard(), directions) & Bitboard(~edges);
+            m.magic = magic_numbers[sq];
+            m.shift = 64 - __builtin_popcountll(m.mask);
+            m.attacks = next_attacks;
+
+            // enumerate all subsets of the mask (carry-rippler)
+            uint64_t subset = 0;
+            do {
+                m.attacks[m.index(subset)] = compute_sliding_attacks(sq, subset, directions);
+                subset = (subset - m.mask) & m.mask;
+            } while (subset);
+            next_attacks += 1ULL << (64 - m.shift);
+        }
+    }
+
+    /**
+     * @brief Returns the squares a bishop on sq attacks given the occupied squares.
+     */
+    static Bitboard bishop_attacks(const uint8_t sq, const Bitboard occupied) {
+        return bishop_magics[sq].attacks[bishop_magics[sq].index(occupied)];
+    }
+
+    /**
+     * @brief Returns the squares a rook on sq attacks given the occupied squares.
+     */
+    static Bitboard rook_attacks(const uint8_t sq, const Bitboard occupied) {
+        return rook_magics[sq].attacks[rook_magics[sq].index(occupied)];
+    }
+
+    /**
+     * @brief Returns the squares a queen on sq attacks given the occupied squares.
+     */
+    static Bitboard queen_attacks(const uint8_t sq, const Bitboard occupied) {
+        return bishop_attacks(sq, occupied) | rook_attacks(sq, occupied);
+    }
+
     static inline Bitboard knight_attacks[64];
     static inline Bitboard pawn_attacks[2][64];
     static inline Bitboard king_attacks[64];
     static inline Bitboard ray_between[64][64];
+    // the whole rank, file or diagonal through both squares, empty if they don't share one
+    static inline Bitboard line_through[64][64];
+    static inline Magic bishop_magics[64];
+    static inline Magic rook_magics[64];
+    static inline Bitboard bishop_table[0x1480];
+    static inline Bitboard rook_table[0x19000];
 
     static void init() {
         for (int sq = 0; sq < 64; ++sq) {
@@ -91,8 +255,11 @@ struct AttackBitboards {
             king_attacks[sq] = compute_king_attacks(sq);
             for (int sq2 = 0; sq2 < 64; ++sq2) {
                 ray_between[sq][sq2] = compute_ray_between(sq, sq2);
+                line_through[sq][sq2] = compute_line_through(sq, sq2);
             }
         }
+        init_magics(bishop_table, bishop_magics, BISHOP_MAGICS, BISHOP_DIRECTIONS);
+        init_magics(rook_table, rook_magics, ROOK_MAGICS, ROOK_DIRECTIONS);
     }
 };
 
@@ -0,0 +1,146 @@
+#include "bench.hpp"
+#include "board.hpp"
+#include "engine.hpp"
+#include "nnue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+const std::vector<std::string> Bench::POSITIONS = {
+    Board::STARTING_BOARD,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+void Bench::thread_scaling(const int depth) {
+    std::cout << "threads        nodes     ms        nps  speedup" << std::endl;
+
+    int64_t single_thread_ms = 0;
+    for (const int threads : THREAD_COUNTS) {
+        Board board;
+        Engine engine(&board);
+        engine.set_threads(threads);
+
+        SearchLimits limits;
+        limits.depth = depth;
+        uint64_t nodes = 0;
+        int64_t ms = 0;
+        for (const std::string& fen : POSITIONS) {
+            board.set_fen(fen);
+            engine.new_game();
+            engine.think(limits);
+
+            nodes += engine.get_nodes();
+            ms += engine.get_elapsed();
+        }
+        if (threads == 1) single_thread_ms = ms;
+
+        ms = std::max<int64_t>(ms, 1);
+        std::cout << std::setw(7) << threads
+                  << std::setw(13) << nodes
+                  << std::setw(7) << ms
+                  << std::setw(11) << nodes * 1000 / ms
+                  << std::setw(9) << std::fixed << std::setprecision(2)
+                  << static_cast<double>(single_thread_ms) / ms << std::endl;
+    }
+}
+
+template <bool COPY_MAKE>
+static uint64_t walk(Board& board, const int depth, BoardState* states) {
+    if (depth == 0) return 1;
+
+    MoveList moves;
+    board.generate(moves);
+    uint64_t nodes = 1;
+    for (const Move& move : moves) {
+        if constexpr (COPY_MAKE) {
+            board.make_move(&move, states[depth]);
+            nodes += walk<COPY_MAKE>(board, depth - 1, states);
+            board.undo_move(states[depth]);
+        } else {
+            board.make_move(&move);
+            nodes += walk<COPY_MAKE>(board, depth - 1, states);
+            board.undo_move();
+        }
+    }
+    return nodes;
+}
+
+template <bool COPY_MAKE>
+static void time_walk(const char* name, const int depth) {
+    std::vector<BoardState> states(depth + 1);
+    uint64_t nodes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string& fen : Bench::POSITIONS) {
+        Board board(fen);
+        nodes += walk<COPY_MAKE>(board, depth, states.data());
+    }
+    const int64_t ms = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    std::cout << std::setw(11) << name
+              << std::setw(13) << nodes
+              << std::setw(7) << ms
+              << std::setw(11) << nodes * 1000 / ms
+              << (COPY_MAKE == Board::COPY_MAKE ? "  (built in)" : "") << std::endl;
+}
+
+template <bool USE_NNUE>
+static uint64_t eval_walk(Board& board, const int depth, BoardState* states, int64_t& checksum) {
+    checksum += USE_NNUE ? board.nnue_score() : board.psq_score();
+    if (depth == 0) return 1;
+
+    MoveList moves;
+    board.generate(moves);
+    uint64_t evals = 1;
+    for (const Move& move : moves) {
+        board.make_move(&move, states[depth]);
+        evals += eval_walk<USE_NNUE>(board, depth - 1, states, checksum);
+        board.undo_move(states[depth]);
+    }
+    return evals;
+}
+
+template <bool USE_NNUE>
+static void time_eval_walk(const char* name, const int depth) {
+    std::vector<BoardState> states(depth + 1);
+    uint64_t evals = 0;
+    // summed so the evaluations can't be optimized away
+    int64_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string& fen : Bench::POSITIONS) {
+        Board board(fen);
+        evals += eval_walk<USE_NNUE>(board, depth, states.data(), checksum);
+    }
+    const int64_t ms = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    std::cout << std::setw(11) << name
+              << std::setw(13) << evals
+              << std::setw(7) << ms
+              << std::setw(11) << evals * 1000 / ms
+              << std::setw(13) << checksum << std::endl;
+}
+
+void Bench::eval_backends(const int depth) {
+    const bool random_network = !NNUE::is_loaded();
+    if (random_network) NNUE::init_random(0);
+
+    std::cout << "  backend        evals     ms    evals/s     checksum" << std::endl;
+    time_eval_walk<false>("pst", depth);
+    time_eval_walk<true>(random_network ? "nnue (rnd)" : "nnue", depth);
+
+    if (random_network) NNUE::unload();
+}
+
+void Bench::make_move_modes(const int depth) {
+    std::cout << "     mode        nodes     ms        nps" << std::endl;
+    time_walk<false>("make/undo", depth);
+    time_walk<true>("copy-make", depth);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct Bench {
+/**
+ * @brief Fixed workloads for measuring the engine, run from the UCI bench command.
+ *
+ * Every run searches the same positions from an empty table so numbers are comparable
+ * between builds and machines.
+ */
+    static constexpr int DEFAULT_DEPTH = 6;
+    static constexpr int THREAD_COUNTS[] = {1, 2, 4, 8, 16};
+    static const std::vector<std::string> POSITIONS;
+
+    /**
+     * @brief Searches every position to a fixed depth at each thread count and prints
+     * the combined nodes, NPS and time-to-depth speedup over one thread.
+     *
+     * @param depth The depth to search each position to.
+     */
+    static void thread_scaling(int depth);
+
+    static constexpr int MAKE_MOVE_DEPTH = 4;
+
+    /**
+     * @brief Walks the move tree of every position to a fixed depth once with make/unmake
+     * and once with copy-make, and prints the NPS of each.
+     *
+     * No leaf counting shortcuts are taken, so every node pays for its move and undo.
+     *
+     * @param depth The depth to walk each position to.
+     */
+    static void make_move_modes(int depth);
+
+    static constexpr int EVAL_DEPTH = 3;
+
+    /**
+     * @brief Walks the move tree of every position to a fixed depth, evaluating every node once
+     * with the piece-square tables and once with the network, and prints the evals per second
+     * of each.
+     *
+     * The network evals include the accumulator updates along the way. Without a loaded
+     * network a random one of the same size is timed instead.
+     *
+     * @param depth The depth to walk each position to.
+     */
+    static void eval_backends(int depth);
+};
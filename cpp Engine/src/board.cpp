@@ -2,6 +2,9 @@
 #include "move.hpp"
 #include "position.hpp"
 #include "attacks.hpp"
+#include "zobrist.hpp"
+#include "psqt.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 
@@ -9,10 +12,35 @@ Board::Board(const std::string fen) {
     set_fen(fen);
 }
 
+Board::Board(const PackedPosition& record) {
+    set_packed(record);
+}
+
+Board::Board(const Board& other) {
+    *this = other;
+}
+
+Board& Board::operator=(const Board& other) {
+    if (this == &other) return *this;
+
+    BoardState::operator=(other);
+    ply_count = other.ply_count;
+    std::copy(other.ply_stack.get(), other.ply_stack.get() + ply_count, ply_stack.get());
+    // accumulators are rebuilt on demand rather than copied
+    if (nnue_frames) {
+        for (int i = 0; i <= ply_count; ++i) nnue_frames[i].invalidate();
+    }
+    update_turn();
+
+    // generated moves are not carried over
+    calculated = false;
+    move_list = &moves;
+    return *this;
+}
+
 void Board::set_fen(const std::string fen) {
     // reset board
     reset();
-    history.clear();
 
     // set board pieces
     int i = 0, sq = 0, real_sq;
@@ -27,9 +55,7 @@ void Board::set_fen(const std::string fen) {
             continue;
         }
         if (std::isdigit(c)) {
-            for (int j = sq; j < sq + (c - '0'); ++j) {
-                squares[j] = Piece::EMPTY;
-            }
+            // reset() already emptied the squares, and sq is in FEN order rather than a board index
             sq += (c - '0');
         } else {
             real_sq = (BOARD_SIZE - 1 - sq / BOARD_SIZE) * BOARD_SIZE + (sq % BOARD_SIZE);
@@ -65,12 +91,12 @@ void Board::set_fen(const std::string fen) {
     if (fen[i] != '-') {
         int file = fen[i] - 'a';
         i++;
-        int rank = BOARD_SIZE - (fen[i] - '0');
+        int rank = fen[i] - '1';
         en_passant_square = Bitboard(1ULL << (rank * BOARD_SIZE + file));
     } else {
         en_passant_square = Bitboard(0);
     }
-    i++;
+    i++; i++;
     
     // set halfmove clock
     halfmove_clock = 0;
@@ -87,9 +113,129 @@ void Board::set_fen(const std::string fen) {
         i++;
     }
 
+    init_state();
+}
+
+void Board::set_packed(const PackedPosition& record) {
+    reset();
+
+    if (__builtin_popcountll(record.occupied) > 32) {
+        throw std::runtime_error("Packed position has more than 32 pieces");
+    }
+    int sq, index = 0;
+    CTZLL_ITERATOR(sq, record.occupied) {
+        const uint8_t nibble = record.piece_at(index++);
+        const int type = PackedPosition::piece_type(nibble);
+        if (type > Piece::KING) {
+            throw std::runtime_error("Packed position has an unknown piece");
+        }
+        const Piece piece(static_cast<Piece::PieceType>(type | (PackedPosition::is_black(nibble) ? Piece::BLACK : Piece::WHITE)));
+        squares[sq] = piece;
+        piece_bitboards[piece.get_color()][piece.get_piece()].add_square(sq);
+        color_bitboards[piece.get_color()].add_square(sq);
+        all_pieces_bitboard.add_square(sq);
+    }
+
+    turn = record.turn ? Turn::BLACK : Turn::WHITE;
+    castling_rights = CastlingRights(record.castling_rights & (CastlingRights::K | CastlingRights::Q | CastlingRights::k | CastlingRights::q));
+    en_passant_square = record.en_passant < 64 ? Bitboard(1ULL << record.en_passant) : Bitboard(0);
+    halfmove_clock = record.halfmove_clock;
+    fullmove_clock = record.fullmove_clock;
+    init_state();
+}
+
+PackedPosition Board::pack() const {
+    PackedPosition record{};
+    record.occupied = all_pieces_bitboard;
+    int sq, index = 0;
+    CTZLL_ITERATOR(sq, record.occupied) {
+        const Piece piece = squares[sq];
+        record.pieces[index / 2] |= (piece.get_color() << 3 | piece.get_piece()) << (index % 2 * 4);
+        index++;
+    }
+
+    record.turn = turn;
+    record.castling_rights = castling_rights.rights;
+    record.en_passant = en_passant_square ? __builtin_ctzll(en_passant_square) : PackedPosition::NO_SQUARE;
+    record.halfmove_clock = static_cast<uint8_t>(std::min<int>(halfmove_clock, 255));
+    record.fullmove_clock = fullmove_clock;
+    record.score = PackedPosition::NO_SCORE;
+    record.result = PackedPosition::NO_RESULT;
+    return record;
+}
+
+void Board::init_state() {
+    hash_key = compute_hash();
+    pawn_key = compute_pawn_hash();
+    psq[Turn::WHITE] = compute_psq(Turn::WHITE);
+    psq[Turn::BLACK] = compute_psq(Turn::BLACK);
+    phase = compute_phase();
     update_turn();
 }
 
+uint64_t Board::compute_hash() const {
+    uint64_t key = 0;
+    int sq;
+    for (int color = 0; color < 2; ++color) {
+        for (int piece = 0; piece < 6; ++piece) {
+            CTZLL_ITERATOR(sq, piece_bitboards[color][piece]) {
+                key ^= Zobrist::pieces[color][piece][sq];
+            }
+        }
+    }
+    key ^= Zobrist::castling[castling_rights.rights];
+    key ^= en_passant_key();
+    if (turn == Turn::BLACK) key ^= Zobrist::side;
+    return key;
+}
+
+uint64_t Board::en_passant_key() const {
+    if (!en_passant_square) return 0;
+    const int sq = __builtin_ctzll(en_passant_square);
+    // the squares an enemy pawn on the en passant square would attack are the ones ours capture from
+    if (!(AttackBitboards::pawn_attacks[!turn][sq] & piece_bitboards[turn][Piece::PAWN])) return 0;
+    return Zobrist::en_passant[sq % BOARD_SIZE];
+}
+
+uint64_t Board::compute_pawn_hash() const {
+    uint64_t key = 0;
+    int sq;
+    for (int color = 0; color < 2; ++color) {
+        CTZLL_ITERATOR(sq, piece_bitboards[color][Piece::PAWN]) {
+            key ^= Zobrist::pieces[color][Piece::PAWN][sq];
+        }
+    }
+    return key;
+}
+
+PSQT::Score Board::compute_psq(const Turn color) const {
+    PSQT::Score score = 0;
+    int sq;
+    for (int piece = 0; piece < 6; ++piece) {
+        CTZLL_ITERATOR(sq, piece_bitboards[color][piece]) {
+            score += PSQT::value(color, static_cast<Piece::PieceType>(piece), sq);
+        }
+    }
+    return score;
+}
+
+int Board::compute_phase() const {
+    int total = 0;
+    for (int piece = 0; piece < 6; ++piece) {
+        total += PSQT::PHASE_WEIGHTS[piece] * (__builtin_popcountll(piece_bitboards[Turn::WHITE][piece])
+                                             + __builtin_popcountll(piece_bitboards[Turn::BLACK][piece]));
+    }
+    return total;
+}
+
+bool Board::check_incremental_state() const {
+    return hash_key == compute_hash()
+        && pawn_key == compute_pawn_hash()
+        && psq[Turn::WHITE] == compute_psq(Turn::WHITE)
+        && psq[Turn::BLACK] == compute_psq(Turn::BLACK)
+        && phase == compute_phase();
+}
+
 const std::string Board::get_fen() {
     int r, c;
     Piece p;
@@ -161,9 +307,14 @@ void Board::reset() {
     castling_rights.reset();
     turn = Turn::WHITE;
     en_passant_square.reset();
-    history.clear();
+    ply_count = 0;
     halfmove_clock = 0;
     fullmove_clock = 1;
+    hash_key = 0;
+    pawn_key = 0;
+    psq[Turn::WHITE] = psq[Turn::BLACK] = 0;
+    phase = 0;
+    if (nnue_frames) nnue_frames[0].invalidate();
     calculated = false;
 }
 
@@ -202,7 +353,7 @@ void Board::print() const {
     std::cout << "En Passant: ";
     if (en_passant_square) {
         int file = __builtin_ctzll(en_passant_square) % BOARD_SIZE;
-        int rank = BOARD_SIZE - (__builtin_ctzll(en_passant_square) / BOARD_SIZE);
+        int rank = __builtin_ctzll(en_passant_square) / BOARD_SIZE + 1;
         std::cout << static_cast<char>('a' + file) << rank;
     } else {
         std::cout << "-";
@@ -210,154 +361,220 @@ void Board::print() const {
     std::cout << "\n";
 }
 
-bool Board::two_pawns_en_passant(const int file, const int rank, const int dir[2], int* two_pawns_sq) const {
-    int next_rank = rank + dir[0];
-    int next_file = file + dir[1];
-    *two_pawns_sq = Position::INVALID_SQUARE;
+GameState Board::get_game_state() {
+    if (!calculated) calculate_moves(moves);
 
-    int sq2;
-    if (!is_valid_fr(next_file, next_rank, &sq2)) return false;
-    const int sq1 = rank * BOARD_SIZE + file;
+    if (moves.empty()) {
+        if (attacker_count == 0) {
+            return GameState::DRAW;
+        } else {
+            return turn == Turn::WHITE ? GameState::BLACK_WIN : GameState::WHITE_WIN;
+        }
+    }
+    if (halfmove_clock >= FIFTY_MOVE_PLIES || is_repetition(0)) return GameState::DRAW;
+    return GameState::IN_PROGRESS;
+}
 
-    const bool same_rank = rank == next_rank;
-    if (!same_rank) return false;
+bool Board::is_repetition(const int search_ply) const {
+    const int window = std::min<int>(halfmove_clock, ply_count);
+    bool repeated_once = false;
+    for (int back = 4; back <= window; back += 2) {
+        if (ply_stack[ply_count - back].hash != hash_key) continue;
+        if (back <= search_ply || repeated_once) return true;
+        repeated_once = true;
+    }
+    return false;
+}
 
-    const bool both_are_pawns = squares[sq1].get_piece() == Piece::PAWN && squares[sq2].get_piece() == Piece::PAWN;
-    if (!both_are_pawns) return false;
+bool Board::is_draw(const int search_ply) {
+    if (halfmove_clock >= FIFTY_MOVE_PLIES) {
+        // a mate on the last move still counts
+        return count_moves() > 0 || !is_in_check();
+    }
+    return is_repetition(search_ply);
+}
 
-    const bool opposite_colors = squares[sq1].get_color() != squares[sq2].get_color();
-    if (!opposite_colors) return false;
+std::vector<Move> Board::get_moves() {
+    if (!calculated) calculate_moves(moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
 
-    const uint8_t friend_sq = (turn == squares[sq1].get_color()) ? sq1 : sq2;
-    const uint8_t enemy_sq = (turn == squares[sq1].get_color()) ? sq2 : sq1;
-    const uint8_t enemy_sq_back_one = enemy_sq + ((turn == Turn::WHITE) ? PAWN_MOVE_ONE : -PAWN_MOVE_ONE);
-    const bool enemy_just_moved_two = en_passant_square.covers(enemy_sq_back_one);
-    if (!enemy_just_moved_two) return false;
+void Board::generate(MoveList& list) {
+    calculate_moves(list);
+}
 
-    *two_pawns_sq = friend_sq;
-    return true;
+void Board::generate_captures(MoveList& list) {
+    calculate_moves(list, true);
 }
 
-bool Board::is_aligned(const int dir[2], const Piece piece) const {
-    return (piece.get_piece() == Piece::QUEEN)
-        || (piece.get_piece() == Piece::ROOK && dir[0] * dir[1] == 0)
-        || (piece.get_piece() == Piece::BISHOP && dir[0] * dir[1] != 0);
+int Board::count_moves() {
+    counting = true;
+    counted = 0;
+    calculate_moves(moves);
+    counting = false;
+    calculated = false;
+    return counted;
 }
 
-void Board::calculate_pins() {
-    const int king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
-    const int king_rank = king_sq / BOARD_SIZE;
-    const int king_file = king_sq % BOARD_SIZE;
-    int new_rank, new_file, new_sq;
-    int two_pawns_sq;
-    Piece new_piece;
-    Bitboard pinned_ray = Bitboard();
-    for (int i = 0; i < BOARD_SQUARES; ++i) {
-        pinned_limits[i].reset();
+#ifndef CHESSLI_LEGACY_MOVEGEN
+void Board::calculate_moves(MoveList& list, const bool captures_only) {
+    move_list = &list;
+    move_list->clear();
+    calculated = (move_list == &moves) && !captures_only;
+
+    const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+    const Bitboard occupied = all_pieces_bitboard;
+
+    // the friendly king is see-through, so it can't retreat along the ray it's attacked on
+    controlled_squares = enemy_attacks(occupied ^ friend_arr[Piece::KING]);
+    checkers = attackers_to(king_sq, occupied) & *enemies;
+    attacker_count = std::min(__builtin_popcountll(checkers), 2);
+
+    const Bitboard capture_mask = captures_only ? *enemies : Bitboard(~0ULL);
+    add_moves(king_sq, AttackBitboards::king_attacks[king_sq] & ~*friends & ~controlled_squares & capture_mask);
+
+    // if the king is in double check, only return king moves
+    if (attacker_count == 2) return;
+
+    // a single check has to be captured or blocked
+    evasion_mask = Bitboard(~0ULL);
+    if (attacker_count == 1) {
+        evasion_mask = AttackBitboards::ray_between[__builtin_ctzll(checkers)][king_sq] | checkers;
     }
-    int pinned_piece_sq;
-    
-    for (auto& dir : KING_DIRECTIONS) {
-        pinned_ray.reset();
-        new_rank = king_rank + dir[0];
-        new_file = king_file + dir[1];
-        pinned_piece_sq = Position::INVALID_SQUARE;
-        two_pawns_sq = Position::INVALID_SQUARE;
-        while (is_valid_fr(new_file, new_rank, &new_sq)) {
-            pinned_ray.add_square(new_sq);
-            new_piece = squares[new_sq];
-            if (!new_piece.is_empty()) {
-                if (two_pawns_sq == Position::INVALID_SQUARE
-                        && two_pawns_en_passant(new_file, new_rank, dir, &two_pawns_sq)) {
-                    // std::cout << "Two pawns en passant, pinned pawn found at " << Move::to_algebraic(two_pawns_sq) << std::endl;
-                    new_rank += dir[0];
-                    new_file += dir[1];
-                } else if (new_piece.is_friendly(turn)) {
-                    if (pinned_piece_sq == Position::INVALID_SQUARE && two_pawns_sq == Position::INVALID_SQUARE) {
-                        pinned_piece_sq = new_sq;
-                    } else {
-                        break;
-                    }
-                } else if (is_aligned(dir, new_piece)) {
-                    if (pinned_piece_sq != Position::INVALID_SQUARE) {
-                        pinned_limits[pinned_piece_sq] = pinned_ray;
-                    } else if (two_pawns_sq != Position::INVALID_SQUARE) {
-                        // std::cout << "setting pinned limit for " << Move::to_algebraic(two_pawns_sq) << " to " << ~en_passant_square << std::endl;
-                        pinned_limits[two_pawns_sq] = ~en_passant_square;
-                    }
-                    break;
-                } else {
-                    break;
-                }
-            }
-            new_rank += dir[0];
-            new_file += dir[1];
-        }
+    target_mask = evasion_mask & ~*friends & capture_mask;
+
+    const Bitboard pinned = pinned_pieces(king_sq);
+    uint8_t sq;
+
+    // a pinned knight can never stay on the line of its pin
+    CTZLL_ITERATOR(sq, friend_arr[Piece::KNIGHT] & ~pinned) {
+        add_moves(sq, AttackBitboards::knight_attacks[sq] & target_mask);
+    }
+
+    // pinned sliders may still move along the line through the king, queens come up in both loops
+    CTZLL_ITERATOR(sq, friend_arr[Piece::BISHOP] | friend_arr[Piece::QUEEN]) {
+        Bitboard targets = AttackBitboards::bishop_attacks(sq, occupied) & target_mask;
+        if (pinned.covers(sq)) targets &= AttackBitboards::line_through[king_sq][sq];
+        add_moves(sq, targets);
+    }
+    CTZLL_ITERATOR(sq, friend_arr[Piece::ROOK] | friend_arr[Piece::QUEEN]) {
+        Bitboard targets = AttackBitboards::rook_attacks(sq, occupied) & target_mask;
+        if (pinned.covers(sq)) targets &= AttackBitboards::line_through[king_sq][sq];
+        add_moves(sq, targets);
     }
+
+    generate_pawn_moves(king_sq, pinned, captures_only);
+    if (!captures_only && attacker_count == 0) generate_castling(king_sq);
 }
 
-GameState Board::get_game_state() {
-    if (!calculated) calculate_moves();
+Bitboard Board::enemy_attacks(const Bitboard occupied) const {
+    const int down = (turn == Turn::WHITE) ? -PAWN_MOVE_ONE : PAWN_MOVE_ONE;
+    const Bitboard pawns = enemy_arr[Piece::PAWN];
+    Bitboard attacks = shift(pawns & ~Bitboard(AttackBitboards::FILE_A), down - 1)
+                     | shift(pawns & ~Bitboard(AttackBitboards::FILE_H), down + 1);
+    if (enemy_arr[Piece::KING]) attacks |= AttackBitboards::king_attacks[__builtin_ctzll(enemy_arr[Piece::KING])];
 
-    if (moves.empty()) {
-        if (attacker_count == 0) {
-            return GameState::DRAW;
-        } else {
-            return turn == Turn::WHITE ? GameState::BLACK_WIN : GameState::WHITE_WIN;
-        }
+    uint8_t sq;
+    CTZLL_ITERATOR(sq, enemy_arr[Piece::KNIGHT]) {
+        attacks |= AttackBitboards::knight_attacks[sq];
     }
-    return GameState::IN_PROGRESS;
+    CTZLL_ITERATOR(sq, enemy_arr[Piece::BISHOP] | enemy_arr[Piece::QUEEN]) {
+        attacks |= AttackBitboards::bishop_attacks(sq, occupied);
+    }
+    CTZLL_ITERATOR(sq, enemy_arr[Piece::ROOK] | enemy_arr[Piece::QUEEN]) {
+        attacks |= AttackBitboards::rook_attacks(sq, occupied);
+    }
+    return attacks;
 }
 
-std::vector<Move> Board::get_moves() {
-    if (!calculated) calculate_moves();
-    return moves;
+Bitboard Board::pinned_pieces(const uint8_t king_sq) const {
+    // enemy sliders that would see the king on an empty board pin the piece if it's the only one between
+    const Bitboard snipers = (AttackBitboards::bishop_attacks(king_sq, Bitboard()) & (enemy_arr[Piece::BISHOP] | enemy_arr[Piece::QUEEN]))
+                           | (AttackBitboards::rook_attacks(king_sq, Bitboard()) & (enemy_arr[Piece::ROOK] | enemy_arr[Piece::QUEEN]));
+    Bitboard pinned;
+    uint8_t sq;
+    CTZLL_ITERATOR(sq, snipers) {
+        const Bitboard between = AttackBitboards::ray_between[sq][king_sq] & all_pieces_bitboard;
+        if (__builtin_popcountll(between) == 1) pinned |= between & *friends;
+    }
+    return pinned;
 }
 
-void Board::calculate_moves() {
-    if (calculated) return;
-
+void Board::generate_pawn_moves(const uint8_t king_sq, const Bitboard pinned, const bool captures_only) {
+    const int up = (turn == Turn::WHITE) ? PAWN_MOVE_ONE : -PAWN_MOVE_ONE;
+    const Bitboard pawns = friend_arr[Piece::PAWN];
+    const Bitboard empty = ~all_pieces_bitboard;
+    const Bitboard last_rank = (turn == Turn::WHITE) ? AttackBitboards::RANK_8 : AttackBitboards::RANK_1;
+    const Bitboard double_push_rank = (turn == Turn::WHITE) ? AttackBitboards::RANK_1 << 16 : AttackBitboards::RANK_8 >> 16;
+
+    // every pawn at once, shifting the whole bitboard
+    Bitboard single_pushes = shift(pawns, up) & empty;
+    Bitboard double_pushes = shift(single_pushes & double_push_rank, up) & empty & evasion_mask;
+    single_pushes &= evasion_mask;
+    if (captures_only) {
+        // a push only counts if it promotes
+        single_pushes &= last_rank;
+        double_pushes.reset();
+    }
+    const Bitboard capturable = *enemies & evasion_mask;
+    const Bitboard left_captures = shift(pawns & ~Bitboard(AttackBitboards::FILE_A), up - 1) & capturable;
+    const Bitboard right_captures = shift(pawns & ~Bitboard(AttackBitboards::FILE_H), up + 1) & capturable;
+
+    add_pawn_moves(single_pushes, up, king_sq, pinned, MoveFlag::NO_FLAG);
+    add_pawn_moves(double_pushes, 2 * up, king_sq, pinned, MoveFlag::PAWN_UP_TWO);
+    add_pawn_moves(left_captures, up - 1, king_sq, pinned, MoveFlag::NO_FLAG);
+    add_pawn_moves(right_captures, up + 1, king_sq, pinned, MoveFlag::NO_FLAG);
+
+    // en passant also answers a check by the pawn that just moved up two
+    if (!en_passant_square) return;
+    const uint8_t ep_sq = __builtin_ctzll(en_passant_square);
+    if (!evasion_mask.covers(ep_sq) && !evasion_mask.covers(ep_sq - up)) return;
     uint8_t sq;
+    CTZLL_ITERATOR(sq, AttackBitboards::pawn_attacks[!turn][ep_sq] & pawns) {
+        // this covers pins too, the king's lines are checked with both pawns gone
+        if (!en_passant_exposes_king(sq, ep_sq)) add_move(Move(sq, ep_sq, MoveFlag::EN_PASSANT_CAPTURE));
+    }
+}
 
-    // reset calculation state
-    controlled_squares.reset();
-    attacker_count = 0;
-    attackers[0] = Position::INVALID_SQUARE;
-    attackers[1] = Position::INVALID_SQUARE;
-    evasion_mask = Bitboard(~0ULL);
-    moves.clear();
+void Board::add_pawn_moves(Bitboard targets, const int offset, const uint8_t king_sq, const Bitboard pinned, const MoveFlag flag) {
+    uint8_t end;
 
-    // calculate controlled squares
-    for (Piece::PieceType piece : PIECES) {
-        CTZLL_ITERATOR(sq, enemy_arr[piece]) {
-            (this->*CALCULATE_CONTROLLED_FUNCTIONS[piece])(sq);
+    // a pinned pawn may only move along the line of its pin
+    if (pinned & friend_arr[Piece::PAWN]) {
+        Bitboard allowed;
+        CTZLL_ITERATOR(end, targets) {
+            const uint8_t start = end - offset;
+            if (!pinned.covers(start) || AttackBitboards::line_through[king_sq][start].covers(end)) allowed.add_square(end);
         }
+        targets = allowed;
     }
 
-    // if the king is in double check, only return king moves
-    if (attacker_count == 2) {
-        const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
-        king_moves(king_sq);
+    const Bitboard promotions = targets & Bitboard((turn == Turn::WHITE) ? AttackBitboards::RANK_8 : AttackBitboards::RANK_1);
+    targets &= ~promotions;
+    if (counting) {
+        counted += __builtin_popcountll(targets) + 4 * __builtin_popcountll(promotions);
         return;
-    } 
-
-    // calculate pins
-    calculate_pins();
-    
-    if (attacker_count == 1) {
-        const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
-        const uint8_t attacker_sq = attackers[0];
-        evasion_mask = AttackBitboards::ray_between[attacker_sq][king_sq];
-        evasion_mask.add_square(attacker_sq);
     }
+    CTZLL_ITERATOR(end, targets) {
+        move_list->push_back(Move(end - offset, end, flag));
+    }
+    CTZLL_ITERATOR(end, promotions) {
+        add_promotions(end - offset, end);
+    }
+}
 
-    // calculate moves, limited by checks and pins
-    for (Piece::PieceType piece : PIECES) {
-        CTZLL_ITERATOR(sq, friend_arr[piece]) {
-            (this->*CALCULATE_MOVES_FUNCTIONS[piece])(sq);
-        }
+void Board::generate_castling(const uint8_t king_sq) {
+    const Bitboard blockers = all_pieces_bitboard | controlled_squares;
+    if (castle_king && (KINGSIDE_CASTLE[turn] & blockers) == 0) {
+        add_move(Move(king_sq, king_sq + 2, MoveFlag::KINGSIDE_CASTLE));
+    }
+    // the rook passes B1/B8 but the king doesn't, so that square only needs to be empty
+    if (castle_queen && (QUEENSIDE_CASTLE[turn] & all_pieces_bitboard) == 0
+            && (QUEENSIDE_CASTLE[turn] & ~QUEENSIDE_ROOK_PATH[turn] & controlled_squares) == 0) {
+        add_move(Move(king_sq, king_sq - 2, MoveFlag::QUEENSIDE_CASTLE));
     }
 }
+#endif
 
 void Board::erase_piece(const int sq) {
     if (squares[sq].is_empty()) {
@@ -365,6 +582,11 @@ void Board::erase_piece(const int sq) {
     }
     Piece piece = squares[sq];
     squares[sq] = Piece::EMPTY;
+    if (nnue_frames) nnue_frames[ply_count].dirty.record(piece, sq, false);
+    hash_key ^= Zobrist::pieces[piece.get_color()][piece.get_piece()][sq];
+    if (piece.get_piece() == Piece::PAWN) pawn_key ^= Zobrist::pieces[piece.get_color()][Piece::PAWN][sq];
+    psq[piece.get_color()] -= PSQT::value(piece.get_color(), piece.get_piece(), sq);
+    phase -= PSQT::PHASE_WEIGHTS[piece.get_piece()];
     piece_bitboards[piece.get_color()][piece.get_piece()].remove_square(sq);
     color_bitboards[piece.get_color()].remove_square(sq);
     all_pieces_bitboard.remove_square(sq);
@@ -375,11 +597,74 @@ void Board::add_piece(const int sq, const Piece piece) {
         return;
     }
     squares[sq] = piece;
+    if (nnue_frames) nnue_frames[ply_count].dirty.record(piece, sq, true);
+    hash_key ^= Zobrist::pieces[piece.get_color()][piece.get_piece()][sq];
+    if (piece.get_piece() == Piece::PAWN) pawn_key ^= Zobrist::pieces[piece.get_color()][Piece::PAWN][sq];
+    psq[piece.get_color()] += PSQT::value(piece.get_color(), piece.get_piece(), sq);
+    phase += PSQT::PHASE_WEIGHTS[piece.get_piece()];
     piece_bitboards[piece.get_color()][piece.get_piece()].add_square(sq);
     color_bitboards[piece.get_color()].add_square(sq);
     all_pieces_bitboard.add_square(sq);
 }
 
+int Board::nnue_score() {
+    if (!nnue_frames) {
+        // nothing was recorded before now, so every position on the stack starts from the board
+        nnue_frames.reset(new NNUE::Frame[PLY_CAPACITY + 1]);
+        for (int i = 0; i <= ply_count; ++i) nnue_frames[i].invalidate();
+    }
+    update_accumulator(Turn::WHITE);
+    update_accumulator(Turn::BLACK);
+    return NNUE::evaluate(nnue_frames[ply_count].accumulator, turn);
+}
+
+void Board::update_accumulator(const Turn perspective) {
+    NNUE::Frame* const frames = nnue_frames.get();
+    if (frames[ply_count].accumulator.computed[perspective]) return;
+
+    // find the nearest ply computed for this side; past a king move of that side or a set-up
+    // position every input is different, so start over from the board instead
+    int from = ply_count;
+    while (!frames[from].accumulator.computed[perspective]) {
+        const NNUE::DirtyPieces& dirty = frames[from].dirty;
+        if (from == 0 || dirty.refresh || dirty.moves_king(perspective)) {
+            refresh_accumulator(perspective);
+            return;
+        }
+        from--;
+    }
+
+    // then replay the changes of the moves since
+    const uint8_t king_sq = __builtin_ctzll(piece_bitboards[perspective][Piece::KING]);
+    int16_t* values = frames[ply_count].accumulator.values[perspective];
+    std::copy(frames[from].accumulator.values[perspective], frames[from].accumulator.values[perspective] + NNUE::L1, values);
+    for (int ply = from + 1; ply <= ply_count; ++ply) {
+        const NNUE::DirtyPieces& dirty = frames[ply].dirty;
+        for (int i = 0; i < dirty.count; ++i) {
+            if (dirty.pieces[i].get_piece() == Piece::KING) continue;
+            const int index = NNUE::feature_index(perspective, king_sq, dirty.pieces[i], dirty.squares[i]);
+            if (dirty.added[i]) {
+                NNUE::add_feature(values, index);
+            } else {
+                NNUE::remove_feature(values, index);
+            }
+        }
+    }
+    frames[ply_count].accumulator.computed[perspective] = true;
+}
+
+void Board::refresh_accumulator(const Turn perspective) {
+    NNUE::Accumulator& accumulator = nnue_frames[ply_count].accumulator;
+    const uint8_t king_sq = __builtin_ctzll(piece_bitboards[perspective][Piece::KING]);
+    NNUE::init_accumulator(accumulator.values[perspective]);
+    Bitboard pieces = all_pieces_bitboard & ~(piece_bitboards[Turn::WHITE][Piece::KING] | piece_bitboards[Turn::BLACK][Piece::KING]);
+    uint8_t sq;
+    CTZLL_ITERATOR(sq, pieces) {
+        NNUE::add_feature(accumulator.values[perspective], NNUE::feature_index(perspective, king_sq, squares[sq], sq));
+    }
+    accumulator.computed[perspective] = true;
+}
+
 void Board::rook_disabling_castling_move(const uint8_t sq) {
     uint8_t right = 0;
     switch (sq) {
@@ -393,12 +678,70 @@ void Board::rook_disabling_castling_move(const uint8_t sq) {
     castling_rights.remove_right(right);
 }
 
+PlyEntry& Board::push_ply(const Move* move) {
+    assert(ply_count < PLY_CAPACITY && "Ply stack overflow!");
+    PlyEntry& entry = ply_stack[ply_count++];
+    if (nnue_frames) nnue_frames[ply_count].reset();
+    entry.hash = hash_key;
+    entry.checkers = checkers;
+    entry.eval = psq_score();
+    entry.move = Move(move->start(), move->end(), move->flag());
+    return entry;
+}
+
 void Board::make_move(const Move* move) {
+    // add what the undo needs on top of the search data
+    PlyEntry& entry = push_ply(move);
+    entry.en_passant_square = en_passant_square;
+    entry.halfmove_clock = halfmove_clock;
+    entry.fullmove_clock = fullmove_clock;
+    entry.taken_piece = squares[move->end()];
+    entry.castling_rights = castling_rights;
+    apply_move(move);
+}
+
+void Board::make_move(const Move* move, BoardState& saved) {
+    // the ply is still recorded so the path stays visible, the undo restores saved instead
+    push_ply(move);
+    saved = *this;
+    apply_move(move);
+}
+
+void Board::undo_move(const BoardState& saved) {
+    assert(ply_count > 0 && "Ply stack underflow!");
+    BoardState::operator=(saved);
+    ply_count--;
+    update_turn();
+    calculated = false;
+}
+
+void Board::make_null_move(BoardState& saved) {
+    assert(!king_in_check() && "Null move while in check!");
+    const Move null_move;
+    PlyEntry& entry = push_ply(&null_move);
+    entry.checkers = 0;
+    saved = *this;
+
+    hash_key ^= en_passant_key();
+    en_passant_square.reset();
+    hash_key ^= Zobrist::side;
+    halfmove_clock = 0;
+    turn = static_cast<Turn>(!turn);
+    update_turn();
+    calculated = false;
+}
+
+bool Board::king_in_check() const {
+    const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+    return attackers_to(king_sq, all_pieces_bitboard) & *enemies;
+}
+
+void Board::apply_move(const Move* move) {
     const uint8_t start = move->start();
     const uint8_t end = move->end();
     const Piece start_piece = squares[start];
     const Piece end_piece = squares[end];
-    Bitboard prev_en_passant_square = en_passant_square;
+    const uint64_t prev_en_passant_key = en_passant_key();
     const CastlingRights prev_castling_rights = castling_rights;
 
     // move the piece to the new square, erasing the old square
@@ -441,6 +784,10 @@ void Board::make_move(const Move* move) {
     if (start_piece.get_piece() == Piece::ROOK) rook_disabling_castling_move(start); 
     if (end_piece.get_piece() == Piece::ROOK) rook_disabling_castling_move(end);
 
+    // hash the non-piece state changes
+    hash_key ^= Zobrist::castling[prev_castling_rights.rights] ^ Zobrist::castling[castling_rights.rights];
+    hash_key ^= prev_en_passant_key ^ Zobrist::side;
+
     // update halfmove clock if there's a capture or pawn move
     halfmove_clock++;
     if (start_piece.get_piece() == Piece::PAWN) halfmove_clock = 0;
@@ -449,24 +796,23 @@ void Board::make_move(const Move* move) {
     // update fullmove clock if black just moved
     if (turn == Turn::BLACK) fullmove_clock++;
 
-    // add the move to the history for undos
-    history.push_back(
-        UnMove(
-            Move(start, end, move->flag()), 
-            end_piece,
-            prev_en_passant_square,
-            prev_castling_rights
-        )
-    );
     turn = static_cast<Turn>(!turn);
+    // whether the new en passant square is hashed depends on the pawns of the side now to move
+    hash_key ^= en_passant_key();
     update_turn();
     calculated = false;
+
+#ifdef CHESSLI_DEBUG_INCREMENTAL
+    if (!check_incremental_state()) {
+        throw std::runtime_error("Incremental state mismatch after move " + move->to_uci());
+    }
+#endif
 }
 
 void Board::undo_move() {
-    if (history.empty()) return;
+    if (ply_count == 0) return;
 
-    const UnMove un_move = history.back();
+    const PlyEntry& un_move = ply_stack[ply_count - 1];
     const Move move = un_move.move;
     const uint8_t start = move.start();
     const uint8_t end = move.end();
@@ -505,10 +851,284 @@ void Board::undo_move() {
         add_piece(start, pawn);
     }
 
-    history.pop_back();
+    hash_key = un_move.hash;
+    halfmove_clock = un_move.halfmove_clock;
+    fullmove_clock = un_move.fullmove_clock;
+    ply_count--;
     turn = static_cast<Turn>(!turn);
     update_turn();
     calculated = false;
+
+#ifdef CHESSLI_DEBUG_INCREMENTAL
+    if (!check_incremental_state()) {
+        throw std::runtime_error("Incremental state mismatch after undoing move " + move.to_uci());
+    }
+#endif
+}
+
+Bitboard Board::attackers_to(const int sq, const Bitboard occupied) const {
+    return (AttackBitboards::pawn_attacks[Turn::BLACK][sq] & piece_bitboards[Turn::WHITE][Piece::PAWN])
+         | (AttackBitboards::pawn_attacks[Turn::WHITE][sq] & piece_bitboards[Turn::BLACK][Piece::PAWN])
+         | (AttackBitboards::knight_attacks[sq] & (piece_bitboards[Turn::WHITE][Piece::KNIGHT] | piece_bitboards[Turn::BLACK][Piece::KNIGHT]))
+         | (AttackBitboards::king_attacks[sq] & (piece_bitboards[Turn::WHITE][Piece::KING] | piece_bitboards[Turn::BLACK][Piece::KING]))
+         | (AttackBitboards::bishop_attacks(sq, occupied) & diagonal_sliders())
+         | (AttackBitboards::rook_attacks(sq, occupied) & straight_sliders());
+}
+
+Piece::PieceType Board::least_valuable(const Bitboard attackers, const Turn side, Bitboard* attacker) const {
+    for (Piece::PieceType piece : PIECES) {
+        const Bitboard candidates = attackers & piece_bitboards[side][piece];
+        if (candidates) {
+            *attacker = Bitboard(1ULL << __builtin_ctzll(candidates));
+            return piece;
+        }
+    }
+    return Piece::EMPTY;
+}
+
+int Board::see_captured_value(const Move& move) const {
+    int value = move.is_en_passant() ? SEE_VALUES[Piece::PAWN]
+              : is_empty(move.end()) ? 0 : SEE_VALUES[squares[move.end()].get_piece()];
+    if (move.is_promotion()) value += SEE_VALUES[move.promotion_piece(turn).get_piece()] - SEE_VALUES[Piece::PAWN];
+    return value;
+}
+
+int Board::see(const Move& move) const {
+    if (move.is_castle()) return 0;
+
+    const uint8_t to = move.end();
+    Bitboard occupied = all_pieces_bitboard ^ Bitboard(1ULL << move.start());
+    if (move.is_en_passant()) occupied.remove_square(turn == Turn::WHITE ? to - PAWN_MOVE_ONE : to + PAWN_MOVE_ONE);
+
+    // gain[d] is what the side making capture d wins if the exchange stopped right after it
+    int gain[32];
+    int d = 0;
+    gain[0] = see_captured_value(move);
+    Piece::PieceType on_square = move.is_promotion() ? move.promotion_piece(turn).get_piece() : squares[move.start()].get_piece();
+
+    Bitboard attackers = attackers_to(to, occupied) & occupied;
+    Turn side = turn;
+    Bitboard attacker;
+    while (true) {
+        side = static_cast<Turn>(!side);
+        const Bitboard side_attackers = attackers & color_bitboards[side];
+        if (!side_attackers) break;
+
+        const Piece::PieceType piece = least_valuable(side_attackers, side, &attacker);
+        // the king can only take last
+        if (piece == Piece::KING && (attackers & color_bitboards[!side])) break;
+
+        d++;
+        gain[d] = SEE_VALUES[on_square] - gain[d - 1];
+        on_square = piece;
+
+        // remove the attacker and let the sliders behind it through
+        occupied ^= attacker;
+        if (piece == Piece::PAWN || piece == Piece::BISHOP || piece == Piece::QUEEN) {
+            attackers |= AttackBitboards::bishop_attacks(to, occupied) & diagonal_sliders();
+        }
+        if (piece == Piece::ROOK || piece == Piece::QUEEN) {
+            attackers |= AttackBitboards::rook_attacks(to, occupied) & straight_sliders();
+        }
+        attackers &= occupied;
+    }
+
+    // each side may stop capturing when continuing would lose
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+bool Board::see_ge(const Move& move, const int threshold) const {
+    if (move.is_castle()) return 0 >= threshold;
+
+    const uint8_t to = move.end();
+    const Piece::PieceType moved = move.is_promotion() ? move.promotion_piece(turn).get_piece() : squares[move.start()].get_piece();
+
+    // even a free capture doesn't reach the threshold
+    int swap = see_captured_value(move) - threshold;
+    if (swap < 0) return false;
+
+    // losing the moved piece for nothing still reaches it
+    swap = SEE_VALUES[moved] - swap;
+    if (swap <= 0) return true;
+
+    Bitboard occupied = all_pieces_bitboard ^ Bitboard(1ULL << move.start());
+    if (move.is_en_passant()) occupied.remove_square(turn == Turn::WHITE ? to - PAWN_MOVE_ONE : to + PAWN_MOVE_ONE);
+
+    Bitboard attackers = attackers_to(to, occupied);
+    Turn side = turn;
+    Bitboard attacker;
+    int result = 1;
+    while (true) {
+        side = static_cast<Turn>(!side);
+        attackers &= occupied;
+        const Bitboard side_attackers = attackers & color_bitboards[side];
+        if (!side_attackers) break;
+
+        // result flips to whether the side that just moved is ahead of the threshold
+        result ^= 1;
+        const Piece::PieceType piece = least_valuable(side_attackers, side, &attacker);
+        if (piece == Piece::KING) {
+            // a king capture only stands if the other side has nothing left to recapture with
+            return (attackers & color_bitboards[!side]) ? result ^ 1 : result;
+        }
+
+        swap = SEE_VALUES[piece] - swap;
+        if (swap < result) break;
+
+        occupied ^= attacker;
+        if (piece == Piece::PAWN || piece == Piece::BISHOP || piece == Piece::QUEEN) {
+            attackers |= AttackBitboards::bishop_attacks(to, occupied) & diagonal_sliders();
+        }
+        if (piece == Piece::ROOK || piece == Piece::QUEEN) {
+            attackers |= AttackBitboards::rook_attacks(to, occupied) & straight_sliders();
+        }
+    }
+    return result;
+}
+
+inline void Board::add_moves(const uint8_t start, Bitboard targets) {
+    if (counting) {
+        counted += __builtin_popcountll(targets);
+        return;
+    }
+    uint8_t end;
+    CTZLL_ITERATOR(end, targets) {
+        move_list->push_back(Move(start, end));
+    }
+}
+
+inline void Board::add_move(const Move move) {
+    if (counting) {
+        counted++;
+        return;
+    }
+    move_list->push_back(move);
+}
+
+inline void Board::add_promotions(const uint8_t start, const uint8_t end) {
+    if (counting) {
+        counted += 4;
+        return;
+    }
+    move_list->push_back(Move(start, end, MoveFlag::QUEEN_PROMOTION));
+    move_list->push_back(Move(start, end, MoveFlag::ROOK_PROMOTION));
+    move_list->push_back(Move(start, end, MoveFlag::BISHOP_PROMOTION));
+    move_list->push_back(Move(start, end, MoveFlag::KNIGHT_PROMOTION));
+}
+
+bool Board::en_passant_exposes_king(const uint8_t sq, const uint8_t new_sq) const {
+    // two pieces leave the line the king may be on, so check the position after the capture
+    const uint8_t captured_sq = (turn == Turn::WHITE) ? new_sq - PAWN_MOVE_ONE : new_sq + PAWN_MOVE_ONE;
+    const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+    const Bitboard occupied = (all_pieces_bitboard ^ Bitboard(1ULL << sq) ^ Bitboard(1ULL << captured_sq)) | Bitboard(1ULL << new_sq);
+    return (AttackBitboards::bishop_attacks(king_sq, occupied) & (enemy_arr[Piece::BISHOP] | enemy_arr[Piece::QUEEN]))
+        || (AttackBitboards::rook_attacks(king_sq, occupied) & (enemy_arr[Piece::ROOK] | enemy_arr[Piece::QUEEN]));
+}
+
+#ifdef CHESSLI_LEGACY_MOVEGEN
+// The square-by-square generator the set-wise one replaced, kept so the two can be
+// compared on the perft suite.
+
+bool Board::is_aligned(const int dir[2], const Piece piece) const {
+    return (piece.get_piece() == Piece::QUEEN)
+        || (piece.get_piece() == Piece::ROOK && dir[0] * dir[1] == 0)
+        || (piece.get_piece() == Piece::BISHOP && dir[0] * dir[1] != 0);
+}
+
+void Board::calculate_pins() {
+    const int king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+    const int king_rank = king_sq / BOARD_SIZE;
+    const int king_file = king_sq % BOARD_SIZE;
+    int new_rank, new_file, new_sq;
+    Piece new_piece;
+    Bitboard pinned_ray = Bitboard();
+    for (int i = 0; i < BOARD_SQUARES; ++i) {
+        pinned_limits[i].reset();
+    }
+    int pinned_piece_sq;
+    
+    for (auto& dir : KING_DIRECTIONS) {
+        pinned_ray.reset();
+        new_rank = king_rank + dir[0];
+        new_file = king_file + dir[1];
+        pinned_piece_sq = Position::INVALID_SQUARE;
+        while (is_valid_fr(new_file, new_rank, &new_sq)) {
+            pinned_ray.add_square(new_sq);
+            new_piece = squares[new_sq];
+            if (!new_piece.is_empty()) {
+                if (new_piece.is_friendly(turn)) {
+                    if (pinned_piece_sq == Position::INVALID_SQUARE) {
+                        pinned_piece_sq = new_sq;
+                    } else {
+                        break;
+                    }
+                } else if (is_aligned(dir, new_piece)) {
+                    if (pinned_piece_sq != Position::INVALID_SQUARE) {
+                        pinned_limits[pinned_piece_sq] = pinned_ray;
+                    }
+                    break;
+                } else {
+                    break;
+                }
+            }
+            new_rank += dir[0];
+            new_file += dir[1];
+        }
+    }
+}
+
+void Board::calculate_moves(MoveList& list, const bool captures_only) {
+    uint8_t sq;
+
+    // reset calculation state
+    controlled_squares.reset();
+    attacker_count = 0;
+    attackers[0] = Position::INVALID_SQUARE;
+    attackers[1] = Position::INVALID_SQUARE;
+    evasion_mask = Bitboard(~0ULL);
+    move_list = &list;
+    move_list->clear();
+    calculated = (move_list == &moves) && !captures_only;
+
+    // calculate controlled squares
+    for (Piece::PieceType piece : PIECES) {
+        CTZLL_ITERATOR(sq, enemy_arr[piece]) {
+            (this->*CALCULATE_CONTROLLED_FUNCTIONS[piece])(sq);
+        }
+    }
+
+    checkers.reset();
+    for (int i = 0; i < attacker_count; ++i) checkers.add_square(attackers[i]);
+
+    // if the king is in double check, only return king moves
+    if (attacker_count == 2) {
+        const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+        captures_only ? king_captures(king_sq) : king_moves(king_sq);
+        return;
+    } 
+
+    // calculate pins
+    calculate_pins();
+    
+    if (attacker_count == 1) {
+        const uint8_t king_sq = __builtin_ctzll(friend_arr[Piece::KING]);
+        const uint8_t attacker_sq = attackers[0];
+        evasion_mask = AttackBitboards::ray_between[attacker_sq][king_sq];
+        evasion_mask.add_square(attacker_sq);
+    }
+
+    // calculate moves, limited by checks and pins
+    target_mask = captures_only ? (evasion_mask & *enemies) : evasion_mask;
+    const auto functions = captures_only ? CALCULATE_CAPTURES_FUNCTIONS : CALCULATE_MOVES_FUNCTIONS;
+    for (Piece::PieceType piece : PIECES) {
+        CTZLL_ITERATOR(sq, friend_arr[piece]) {
+            (this->*functions[piece])(sq);
+        }
+    }
 }
 
 inline void Board::add_king_attacker(const uint8_t start, Bitboard attacks) {
@@ -547,12 +1167,9 @@ void Board::pawn_moves(const uint8_t sq) {
         // pawn up one
         if (evasion_mask.covers(new_sq)) {
             if ((rank == PAWN_PROMOTION_RANK_WHITE && is_white) || (rank == PAWN_PROMOTION_RANK_BLACK && !is_white)) {
-                moves.push_back(Move(sq, new_sq, MoveFlag::QUEEN_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::ROOK_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::BISHOP_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::KNIGHT_PROMOTION));
+                add_promotions(sq, new_sq);
             } else {
-                moves.push_back(Move(sq, new_sq));
+                add_move(Move(sq, new_sq));
             }
         }
         // pawn up two
@@ -562,7 +1179,7 @@ void Board::pawn_moves(const uint8_t sq) {
                     && squares[new_sq].is_empty()
                     && can_move_under_pin(sq, new_sq)) {
                 if (evasion_mask.covers(new_sq)) {
-                    moves.push_back(Move(sq, new_sq, MoveFlag::PAWN_UP_TWO));
+                    add_move(Move(sq, new_sq, MoveFlag::PAWN_UP_TWO));
                 }
             }
         }
@@ -575,18 +1192,45 @@ void Board::pawn_moves(const uint8_t sq) {
                 && evasion_mask.covers(new_sq)
                 && can_move_under_pin(sq, new_sq)) {
             if ((rank == PAWN_PROMOTION_RANK_WHITE && is_white) || (rank == PAWN_PROMOTION_RANK_BLACK && !is_white)) {
-                moves.push_back(Move(sq, new_sq, MoveFlag::QUEEN_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::ROOK_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::BISHOP_PROMOTION));
-                moves.push_back(Move(sq, new_sq, MoveFlag::KNIGHT_PROMOTION));
+                add_promotions(sq, new_sq);
             } else {
-                moves.push_back(Move(sq, new_sq));
+                add_move(Move(sq, new_sq));
             }
         } else if (squares[new_sq].is_empty()
                 && en_passant_square.covers(new_sq)
-                && evasion_mask.covers(new_sq)
-                && can_move_under_pin(sq, new_sq)) {
-            moves.push_back(Move(sq, new_sq, MoveFlag::EN_PASSANT_CAPTURE));
+                && (evasion_mask.covers(new_sq) || evasion_mask.covers(new_sq - forward * PAWN_MOVE_ONE))
+                && can_move_under_pin(sq, new_sq)
+                && !en_passant_exposes_king(sq, new_sq)) {
+            add_move(Move(sq, new_sq, MoveFlag::EN_PASSANT_CAPTURE));
+        }
+    }
+}
+
+void Board::pawn_captures(const uint8_t sq) {
+    const int rank = sq / BOARD_SIZE;
+    const int forward = (turn == Turn::WHITE) ? PAWN_MOVE_ONE : -PAWN_MOVE_ONE;
+    const bool promotes = (turn == Turn::WHITE) ? rank == PAWN_PROMOTION_RANK_WHITE : rank == PAWN_PROMOTION_RANK_BLACK;
+    uint8_t new_sq;
+
+    // a push only counts if it promotes
+    Bitboard targets = AttackBitboards::pawn_attacks[turn][sq] & target_mask;
+    if (promotes && is_empty(sq + forward) && evasion_mask.covers(sq + forward)) targets.add_square(sq + forward);
+    if (pinned_limits[sq]) targets &= pinned_limits[sq];
+
+    CTZLL_ITERATOR(new_sq, targets) {
+        if (promotes) {
+            add_promotions(sq, new_sq);
+        } else {
+            add_move(Move(sq, new_sq));
+        }
+    }
+
+    // en passant, under the same conditions as in pawn_moves
+    CTZLL_ITERATOR(new_sq, AttackBitboards::pawn_attacks[turn][sq] & en_passant_square) {
+        if ((evasion_mask.covers(new_sq) || evasion_mask.covers(new_sq - forward))
+                && can_move_under_pin(sq, new_sq)
+                && !en_passant_exposes_king(sq, new_sq)) {
+            add_move(Move(sq, new_sq, MoveFlag::EN_PASSANT_CAPTURE));
         }
     }
 }
@@ -598,115 +1242,48 @@ void Board::knight_controlled(const uint8_t sq) {
 }
 
 void Board::knight_moves(const uint8_t sq) {
-    uint8_t new_sq;
     Bitboard attacks = AttackBitboards::knight_attacks[sq];
 
     // if knight is pinned, it definitely can't move
     if (pinned_limits[sq]) return;
-    CTZLL_ITERATOR(new_sq, attacks) {
-        if (!evasion_mask.covers(new_sq)) continue;
-        if (squares[new_sq].is_empty() || squares[new_sq].is_enemy(turn)) {
-            moves.push_back(Move(sq, new_sq));
-        }
-    }
+    add_moves(sq, attacks & ~*friends & target_mask);
 }
 
 void Board::bishop_controlled(const uint8_t sq) {
-    const int rank = sq / BOARD_SIZE;
-    const int file = sq % BOARD_SIZE;
-    int new_rank, new_file, new_sq;
-    Bitboard attacks = Bitboard();
-
-    for (auto& dir : BISHOP_DIRECTIONS) {
-        new_rank = rank + dir[0];
-        new_file = file + dir[1];
-        while (is_valid_fr(new_file, new_rank, &new_sq)) {
-            attacks.add_square(new_sq);
-            if (!squares[new_sq].is_empty() && squares[new_sq].get_piece() != Piece::KING) break;
-            new_rank += dir[0];
-            new_file += dir[1];
-        }
-    }
+    // the friendly king is see-through, so it can't retreat along the ray it's attacked on
+    Bitboard attacks = AttackBitboards::bishop_attacks(sq, all_pieces_bitboard ^ friend_arr[Piece::KING]);
     add_king_attacker(sq, attacks);
     controlled_squares |= attacks;
 }
 
 void Board::bishop_moves(const uint8_t sq) {
-    const int rank = sq / BOARD_SIZE;
-    const int file = sq % BOARD_SIZE;
-    int new_rank, new_file, new_sq;
-
-    for (auto& dir : BISHOP_DIRECTIONS) {
-        MOVE_ITERATOR(dir, rank, file, new_rank, new_file, new_sq) {
-            if (!can_move_under_pin(sq, new_sq)) break;
-            if (squares[new_sq].is_friendly(turn)) break;
-
-            bool evasion_mask_covers = evasion_mask.covers(new_sq);
-
-            if (squares[new_sq].is_empty()) {
-                if (evasion_mask_covers) moves.push_back(Move(sq, new_sq));
-                continue;
-            } else if (squares[new_sq].is_enemy(turn)) {
-                if (evasion_mask_covers) moves.push_back(Move(sq, new_sq));
-                break;
-            }
-            throw std::runtime_error("Bishop move error, square " + std::to_string(new_sq) + " is not friendly, empty, or enemy");
-        }
-    }
+    Bitboard attacks = AttackBitboards::bishop_attacks(sq, all_pieces_bitboard) & ~*friends & target_mask;
+    if (pinned_limits[sq]) attacks &= pinned_limits[sq];
+    add_moves(sq, attacks);
 }
 
 void Board::rook_controlled(const uint8_t sq) {
-    const int rank = sq / BOARD_SIZE;
-    const int file = sq % BOARD_SIZE;
-    int new_rank, new_file, new_sq;
-    Bitboard attacks = Bitboard();
-
-    for (auto& dir : ROOK_DIRECTIONS) {
-        new_rank = rank + dir[0];
-        new_file = file + dir[1];
-        while (is_valid_fr(new_file, new_rank, &new_sq)) {
-            attacks.add_square(new_sq);
-            if (!squares[new_sq].is_empty() && squares[new_sq].get_piece() != Piece::KING) break;
-            new_rank += dir[0];
-            new_file += dir[1];
-        }
-    }
+    Bitboard attacks = AttackBitboards::rook_attacks(sq, all_pieces_bitboard ^ friend_arr[Piece::KING]);
     add_king_attacker(sq, attacks);
     controlled_squares |= attacks;
 }
 
 void Board::rook_moves(const uint8_t sq) {
-    const int rank = sq / BOARD_SIZE;
-    const int file = sq % BOARD_SIZE;
-    int new_rank, new_file, new_sq;
-
-    for (auto& dir : ROOK_DIRECTIONS) {
-        MOVE_ITERATOR(dir, rank, file, new_rank, new_file, new_sq) {
-            if (!can_move_under_pin(sq, new_sq)) break;
-            if (squares[new_sq].is_friendly(turn)) break;
-
-            bool evasion_mask_covers = evasion_mask.covers(new_sq);
-
-            if (squares[new_sq].is_empty()) {
-                if (evasion_mask_covers) moves.push_back(Move(sq, new_sq));
-                continue;
-            } else if (squares[new_sq].is_enemy(turn)) {
-                if (evasion_mask_covers) moves.push_back(Move(sq, new_sq));
-                break;
-            }
-            throw std::runtime_error("Rook move error, square " + std::to_string(new_sq) + " is not friendly, empty, or enemy");
-        }
-    }
+    Bitboard attacks = AttackBitboards::rook_attacks(sq, all_pieces_bitboard) & ~*friends & target_mask;
+    if (pinned_limits[sq]) attacks &= pinned_limits[sq];
+    add_moves(sq, attacks);
 }
 
 void Board::queen_controlled(const uint8_t sq) {
-    bishop_controlled(sq);
-    rook_controlled(sq);
+    Bitboard attacks = AttackBitboards::queen_attacks(sq, all_pieces_bitboard ^ friend_arr[Piece::KING]);
+    add_king_attacker(sq, attacks);
+    controlled_squares |= attacks;
 }
 
 void Board::queen_moves(const uint8_t sq) {
-    bishop_moves(sq);
-    rook_moves(sq);
+    Bitboard attacks = AttackBitboards::queen_attacks(sq, all_pieces_bitboard) & ~*friends & target_mask;
+    if (pinned_limits[sq]) attacks &= pinned_limits[sq];
+    add_moves(sq, attacks);
 }
 
 void Board::king_controlled(const uint8_t sq) {
@@ -715,28 +1292,25 @@ void Board::king_controlled(const uint8_t sq) {
     controlled_squares |= attacks;
 }
 
-void Board::king_moves(const uint8_t sq) {
-    uint8_t new_sq;
+void Board::king_captures(const uint8_t sq) {
+    add_moves(sq, AttackBitboards::king_attacks[sq] & *enemies & ~controlled_squares);
+}
 
+void Board::king_moves(const uint8_t sq) {
     // calculate moves, limited by enemy controlled squares
-    CTZLL_ITERATOR(new_sq, AttackBitboards::king_attacks[sq]) {
-        if (controlled_squares.covers(new_sq)) continue;
-
-        if (squares[new_sq].is_empty()) {
-            moves.push_back(Move(sq, new_sq));
-        } else if (squares[new_sq].is_enemy(turn)) {
-            moves.push_back(Move(sq, new_sq));
-        }
-    }
+    add_moves(sq, AttackBitboards::king_attacks[sq] & ~*friends & ~controlled_squares);
 
     // check for castling
     if (attacker_count == 0) {
         const Bitboard blockers = all_pieces_bitboard | controlled_squares;
         if (castle_king && (KINGSIDE_CASTLE[turn] & blockers) == 0) {
-            moves.push_back(Move(sq, sq + 2, MoveFlag::KINGSIDE_CASTLE));
+            add_move(Move(sq, sq + 2, MoveFlag::KINGSIDE_CASTLE));
         }
-        if (castle_queen && (QUEENSIDE_CASTLE[turn] & blockers) == 0) {
-            moves.push_back(Move(sq, sq - 2, MoveFlag::QUEENSIDE_CASTLE));
+        // the rook passes B1/B8 but the king doesn't, so that square only needs to be empty
+        if (castle_queen && (QUEENSIDE_CASTLE[turn] & all_pieces_bitboard) == 0
+                && (QUEENSIDE_CASTLE[turn] & ~QUEENSIDE_ROOK_PATH[turn] & controlled_squares) == 0) {
+            add_move(Move(sq, sq - 2, MoveFlag::QUEENSIDE_CASTLE));
         }
     }
-}
\ No newline at end of file
+}
+#endif
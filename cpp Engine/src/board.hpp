@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cassert>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "piece.hpp"
@@ -9,6 +12,10 @@
 #include "position.hpp"
 #include "turn.hpp"
 #include "move.hpp"
+#include "move_list.hpp"
+#include "nnue.hpp"
+#include "packed_position.hpp"
+#include "psqt.hpp"
 
 enum GameState {
     WHITE_WIN,
@@ -17,11 +24,61 @@ enum GameState {
     IN_PROGRESS
 };
 
-class Board {
+/**
+ * @brief Everything a move changes on the board, kept trivially copyable so a search can
+ * save it before a move and restore it with a plain copy instead of undoing the move.
+ */
+struct BoardState {
+    Bitboard piece_bitboards[2][6];
+    Bitboard color_bitboards[2];
+    Bitboard all_pieces_bitboard;
+    Bitboard en_passant_square;
+    uint64_t hash_key;
+    // Zobrist key of the pawns alone, for the pawn structure cache
+    uint64_t pawn_key;
+    PSQT::Score psq[2];
+    // sum of PSQT::PHASE_WEIGHTS over the pieces on the board
+    int phase;
+    uint16_t halfmove_clock;
+    uint16_t fullmove_clock;
+    Piece squares[64];
+    CastlingRights castling_rights;
+    Turn turn;
+};
+static_assert(std::is_trivially_copyable_v<BoardState>);
+
+/**
+ * @brief One ply of the game and search so far: what undoing the move needs, plus data
+ * about the position it was made from that the search can read back.
+ */
+struct PlyEntry {
+    uint64_t hash;
+    Bitboard checkers;
+    Bitboard en_passant_square;
+    int eval;
+    uint16_t halfmove_clock;
+    uint16_t fullmove_clock;
+    Move move;
+    Piece taken_piece;
+    CastlingRights castling_rights;
+};
+
+class Board : private BoardState {
 public:
     friend class Engine;
+
+#ifdef CHESSLI_COPY_MAKE
+    static constexpr bool COPY_MAKE = true;
+#else
+    static constexpr bool COPY_MAKE = false;
+#endif
     
     static constexpr const char* STARTING_BOARD = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    // the ply stack is allocated once at this size and never grows
+    static constexpr int MAX_GAME_PLIES = 2048;
+    static constexpr int MAX_SEARCH_PLIES = 256;
+    static constexpr int PLY_CAPACITY = MAX_GAME_PLIES + MAX_SEARCH_PLIES;
+    static constexpr int FIFTY_MOVE_PLIES = 100;
     /**
      * @brief Constructs a new Board object from a FEN string.
      * 
@@ -29,6 +86,21 @@ public:
      */
     Board(std::string fen = STARTING_BOARD);
 
+    /**
+     * @brief Constructs a new Board object from a packed record.
+     *
+     * @param record
+     */
+    explicit Board(const PackedPosition& record);
+
+    /**
+     * @brief Copies a Board, e.g. to give each search thread its own.
+     *
+     * The turn pointers are re-pointed at the copy's own bitboards.
+     */
+    Board(const Board& other);
+    Board& operator=(const Board& other);
+
     /**
      * @brief Sets the Board position, resets history
      * 
@@ -43,6 +115,19 @@ public:
      */
     const std::string get_fen();
 
+    /**
+     * @brief Sets the Board position from a packed record, resets history.
+     *
+     * @param record The position; its score, best move and result are not used.
+     * @throws std::runtime_error if the record holds more than 32 pieces or an unknown piece.
+     */
+    void set_packed(const PackedPosition& record);
+
+    /**
+     * @brief Packs the current position, with no score, best move or result.
+     */
+    PackedPosition pack() const;
+
     /**
      * @brief Prints the board to the console.
      * 
@@ -56,6 +141,28 @@ public:
      */
     std::vector<Move> get_moves();
 
+    /**
+     * @brief Generates valid moves for the current position straight into caller storage.
+     *
+     * @param list The list to fill, cleared first.
+     */
+    void generate(MoveList& list);
+
+    /**
+     * @brief Generates only the valid captures and promotions, skipping quiet moves.
+     *
+     * @param list The list to fill, cleared first.
+     */
+    void generate_captures(MoveList& list);
+
+    /**
+     * @brief Counts the valid moves without storing them, by popcount where the generator
+     * works on destination masks.
+     *
+     * @return The number of valid moves.
+     */
+    int count_moves();
+
     /**
      * @brief Makes the move on the board, assumes a valid move.
      * 
@@ -63,6 +170,14 @@ public:
      */
     void make_move(const Move* move);
 
+    /**
+     * @brief Makes the move, keeping the state before it so the undo is a plain copy (copy-make).
+     *
+     * @param move The move to be made.
+     * @param saved Receives the state before the move, for undo_move(saved).
+     */
+    void make_move(const Move* move, BoardState& saved);
+
     /** 
      * @brief Returns the piece at a given square.
      * 
@@ -98,6 +213,44 @@ public:
         return controlled_squares.covers(sq);
     }
 
+    /**
+     * @brief Returns if the side to move is in check, valid after moves are generated.
+     */
+    constexpr bool is_in_check() const {
+        return attacker_count > 0;
+    }
+
+    /**
+     * @brief Returns every piece of either color attacking a square.
+     *
+     * @param sq The square (0-63).
+     * @param occupied The occupancy sliders are blocked by.
+     * @return The squares of the attackers.
+     */
+    Bitboard attackers_to(const int sq, const Bitboard occupied) const;
+
+    /**
+     * @brief Static exchange evaluation of a move.
+     *
+     * Plays out the exchange on the target square with both sides recapturing with their
+     * least valuable attacker and stopping when that would lose material. Sliders behind an
+     * attacker join in once it has captured. Pins are ignored.
+     *
+     * @param move The move to evaluate, usually a capture.
+     * @return The material gained by the side to move, in centipawns.
+     */
+    int see(const Move& move) const;
+
+    /**
+     * @brief Returns if the static exchange evaluation of a move is at least a threshold.
+     *
+     * Same result as see(move) >= threshold, but stops as soon as the answer is known.
+     *
+     * @param move The move to evaluate.
+     * @param threshold The score to compare against, in centipawns.
+     */
+    bool see_ge(const Move& move, const int threshold) const;
+
     /**
      * @brief Returns the current turn.
      * 
@@ -114,9 +267,158 @@ public:
     void undo_move();
 
     /**
-     * @brief Returns the plycount (halfmoves) as the number of recorded moves
+     * @brief Undoes a copy-made move by restoring the state saved before it.
+     *
+     * @param saved The state make_move(move, saved) stored.
+     */
+    void undo_move(const BoardState& saved);
+
+    /**
+     * @brief Passes the turn without moving, for null-move pruning.
+     *
+     * The side to move must not be in check. The ply is recorded with an empty move and the
+     * halfmove clock restarts, so repetitions are never matched across the null move.
+     *
+     * @param saved Receives the state before the null move, for undo_move(saved).
+     */
+    void make_null_move(BoardState& saved);
+
+    /**
+     * @brief Returns if the side to move is in check, computed directly so it also works
+     * before the moves are generated.
      */
-    uint16_t get_ply_count() const { return history.size(); }
+    bool king_in_check() const;
+
+    /**
+     * @brief Returns if a side has any piece besides its pawns and king.
+     *
+     * @param side The side to look at.
+     */
+    constexpr bool has_non_pawn_material(const Turn side) const {
+        return piece_bitboards[side][Piece::KNIGHT] | piece_bitboards[side][Piece::BISHOP]
+             | piece_bitboards[side][Piece::ROOK] | piece_bitboards[side][Piece::QUEEN];
+    }
+
+    /**
+     * @brief Returns the Zobrist key of the current position.
+     */
+    constexpr uint64_t hash() const {
+        return hash_key;
+    }
+
+    /**
+     * @brief Recomputes the Zobrist key from scratch.
+     *
+     * The en passant file is only hashed when the side to move has a pawn attacking the en
+     * passant square, so a double push nothing can capture doesn't change the key of the
+     * position after it.
+     *
+     * @return The Zobrist key of the current position.
+     */
+    uint64_t compute_hash() const;
+
+    /**
+     * @brief Returns the Zobrist key of the pawns alone, equal for positions with the same pawns.
+     */
+    constexpr uint64_t pawn_hash() const {
+        return pawn_key;
+    }
+
+    /**
+     * @brief Recomputes the pawn key from scratch.
+     *
+     * @return The XOR of the piece keys of every pawn on the board.
+     */
+    uint64_t compute_pawn_hash() const;
+
+    /**
+     * @brief Returns the squares of one kind of piece of one side.
+     *
+     * @param color The side.
+     * @param piece The type of piece.
+     */
+    constexpr Bitboard get_pieces(const Turn color, const Piece::PieceType piece) const {
+        return piece_bitboards[color][piece];
+    }
+
+    /**
+     * @brief Returns every occupied square.
+     */
+    constexpr Bitboard get_occupied() const {
+        return all_pieces_bitboard;
+    }
+
+    /**
+     * @brief Checks the incrementally updated state against a full recomputation.
+     *
+     * @return true if every incremental value matches its recomputed value.
+     */
+    bool check_incremental_state() const;
+
+    /**
+     * @brief Returns the material plus piece-square score from the side to move's view,
+     * blended between its middlegame and endgame values by the game phase.
+     */
+    constexpr int psq_score() const {
+        return PSQT::taper(psq_pair(), phase);
+    }
+
+    /**
+     * @brief Returns the material plus piece-square score from the side to move's view, both
+     * phases packed and not yet tapered, for adding further terms before tapering.
+     */
+    constexpr PSQT::Score psq_pair() const {
+        return psq[turn] - psq[!turn];
+    }
+
+    /**
+     * @brief Returns the game phase, the sum of PSQT::PHASE_WEIGHTS over the pieces on the board.
+     */
+    constexpr int get_phase() const {
+        return phase;
+    }
+
+    /**
+     * @brief Recomputes the material plus piece-square total of one side from scratch.
+     *
+     * @param color The side to sum.
+     * @return The total over every piece of that side, both phases packed.
+     */
+    PSQT::Score compute_psq(const Turn color) const;
+
+    /**
+     * @brief Recomputes the game phase from scratch.
+     *
+     * @return The sum of PSQT::PHASE_WEIGHTS over the pieces on the board.
+     */
+    int compute_phase() const;
+
+    /**
+     * @brief Evaluates the position with the loaded network, from the side to move's view.
+     *
+     * Brings the accumulators of the current ply up to date first, from the nearest ply that
+     * has them. The first call allocates the frames the accumulators are kept in. Only valid
+     * while NNUE::is_loaded().
+     */
+    int nnue_score();
+
+    /**
+     * @brief Returns the plycount (halfmoves) as the number of moves made since the position was set
+     */
+    int get_ply_count() const { return ply_count; }
+
+    /**
+     * @brief Returns a recorded ply.
+     *
+     * Entry i holds the position before move i: its key, its psq_score() and its checkers,
+     * as of the last move generation for it (which the search always does before moving).
+     *
+     * @param ply The ply, from 0 to get_ply_count() - 1.
+     */
+    const PlyEntry& get_ply(const int ply) const {
+        assert(ply >= 0 && ply < ply_count && "Ply out of range!");
+        return ply_stack[ply];
+    }
 
     /**
      * @brief Returns the number of halfmoves since the last capture or pawn move
@@ -133,20 +435,38 @@ public:
      */
     GameState get_game_state();
 
+    /**
+     * @brief Returns if the position repeats an earlier one.
+     *
+     * Only positions since the last capture or pawn move can repeat, and only those with
+     * the same side to move, so just every second ply within the halfmove clock is checked.
+     * A repeat inside the search counts at once, since the side that allowed it can repeat
+     * again; before the search root it takes a threefold repetition.
+     *
+     * @param search_ply How many of the recorded plies belong to the search, 0 for the game.
+     */
+    bool is_repetition(const int search_ply) const;
+
+    /**
+     * @brief Returns if the position is a draw by repetition or by the 50-move rule.
+     *
+     * Cheap except on the rare positions at the 50-move limit, where moves are counted to
+     * rule out a mate.
+     *
+     * @param search_ply How many of the recorded plies belong to the search, 0 for the game.
+     */
+    bool is_draw(const int search_ply);
+
 private:
     /* VARIABLES */
 
-    // board state
-    Piece squares[64];
-    Bitboard piece_bitboards[2][6];
-    Bitboard color_bitboards[2];
-    Bitboard all_pieces_bitboard;
-    CastlingRights castling_rights;
-    Turn turn;
-    Bitboard en_passant_square;
-    std::vector<UnMove> history;
-    uint16_t halfmove_clock;
-    uint16_t fullmove_clock;
+    // board state, the rest lives in BoardState
+    std::unique_ptr<PlyEntry[]> ply_stack = std::make_unique<PlyEntry[]>(PLY_CAPACITY);
+    int ply_count = 0;
+    // one NNUE frame per position on the ply stack, the last one is the current position.
+    // Allocated by the first nnue_score(), so boards that never evaluate with a network
+    // (the PST fallback, perft, the tools) don't pay for 2.6 MB of frames
+    std::unique_ptr<NNUE::Frame[]> nnue_frames;
 
     // turn state
     bool castle_king, castle_queen;
@@ -159,33 +479,66 @@ private:
     bool calculated = false;
     Bitboard controlled_squares;
     uint8_t attacker_count;
+    Bitboard checkers;
+#ifdef CHESSLI_LEGACY_MOVEGEN
     uint8_t attackers[2];
     Bitboard pinned_limits[64];
+#endif
     Bitboard evasion_mask;
-    std::vector<Move> moves;
-
-    // Macro for iterating over sliding piece directions
-    #define MOVE_ITERATOR(dir, rank, file, new_rank, new_file, new_sq) \
-        for (new_rank = rank + dir[0], new_file = file + dir[1]; \
-            is_valid_fr(new_file, new_rank, &new_sq); \
-            new_rank += dir[0], new_file += dir[1])
+    Bitboard target_mask;
+    MoveList moves;
+    MoveList* move_list;
+    bool counting = false;
+    int counted = 0;
 
     // METHODS
     void reset();
+    // recomputes the keys, scores and turn data once the pieces and flags are set
+    void init_state();
     void update_turn();
     bool is_valid_fr(const int file, const int rank, int* sq) const;
     void erase_piece(const int sq);
     void add_piece(const int sq, const Piece piece);
     void rook_disabling_castling_move(const uint8_t sq);
+    void apply_move(const Move* move);
+    PlyEntry& push_ply(const Move* move);
+    // the en passant file key if a pawn of the side to move can capture there, else 0
+    uint64_t en_passant_key() const;
+    void update_accumulator(const Turn perspective);
+    void refresh_accumulator(const Turn perspective);
+    inline void add_moves(const uint8_t start, Bitboard targets);
+    inline void add_move(const Move move);
+    inline void add_promotions(const uint8_t start, const uint8_t end);
+    bool en_passant_exposes_king(const uint8_t sq, const uint8_t new_sq) const;
+    Piece::PieceType least_valuable(const Bitboard attackers, const Turn side, Bitboard* attacker) const;
+    constexpr Bitboard diagonal_sliders() const {
+        return piece_bitboards[Turn::WHITE][Piece::BISHOP] | piece_bitboards[Turn::BLACK][Piece::BISHOP]
+             | piece_bitboards[Turn::WHITE][Piece::QUEEN] | piece_bitboards[Turn::BLACK][Piece::QUEEN];
+    }
+    constexpr Bitboard straight_sliders() const {
+        return piece_bitboards[Turn::WHITE][Piece::ROOK] | piece_bitboards[Turn::BLACK][Piece::ROOK]
+             | piece_bitboards[Turn::WHITE][Piece::QUEEN] | piece_bitboards[Turn::BLACK][Piece::QUEEN];
+    }
+    int see_captured_value(const Move& move) const;
+
+    // MOVE GENERATION
+    void calculate_moves(MoveList& list, const bool captures_only = false);
+
+#ifndef CHESSLI_LEGACY_MOVEGEN
+    Bitboard enemy_attacks(const Bitboard occupied) const;
+    Bitboard pinned_pieces(const uint8_t king_sq) const;
+    void generate_pawn_moves(const uint8_t king_sq, const Bitboard pinned, const bool captures_only);
+    void add_pawn_moves(Bitboard targets, const int offset, const uint8_t king_sq, const Bitboard pinned, const MoveFlag flag);
+    void generate_castling(const uint8_t king_sq);
+    static constexpr Bitboard shift(const Bitboard bb, const int offset) {
+        return offset > 0 ? Bitboard(static_cast<uint64_t>(bb) << offset) : Bitboard(static_cast<uint64_t>(bb) >> -offset);
+    }
+#else
     inline void add_king_attacker(const uint8_t start, Bitboard attacks);
     void calculate_pins();
     inline bool can_move_under_pin(const uint8_t sq, const uint8_t new_sq);
-    bool two_pawns_en_passant(const int file, const int rank, const int dir[2], int* two_pawns_sq) const;
     bool is_aligned(const int dir[2], const Piece piece) const;
 
-    // MOVE GENERATION
-    void calculate_moves();
-
     void pawn_controlled(const uint8_t sq);
     void knight_controlled(const uint8_t sq);
     void bishop_controlled(const uint8_t sq);
@@ -200,16 +553,15 @@ private:
     void queen_moves(const uint8_t sq);
     void king_moves(const uint8_t sq);
 
+    void pawn_captures(const uint8_t sq);
+    void king_captures(const uint8_t sq);
+#endif
+
     // CONSTANTS
     static constexpr int BOARD_SIZE = 8;
     static constexpr int BOARD_SQUARES = 64;
     static constexpr Piece::PieceType PIECES[] = { Piece::PAWN, Piece::KNIGHT, Piece::BISHOP, Piece::ROOK, Piece::QUEEN, Piece::KING };
-    static constexpr int BISHOP_DIRECTIONS[4][2] = {
-        { 1,  1}, { 1, -1}, {-1, -1}, {-1,  1}
-    };
-    static constexpr int ROOK_DIRECTIONS[4][2] = {
-        { 1,  0}, { 0,  1}, {-1,  0}, { 0, -1}
-    };
+#ifdef CHESSLI_LEGACY_MOVEGEN
     static constexpr int KING_DIRECTIONS[8][2] = {
         { 1,  1}, { 1,  0}, { 1, -1}, { 0, -1},
         {-1, -1}, {-1,  0}, {-1,  1}, { 0,  1}
@@ -222,6 +574,15 @@ private:
         &Board::queen_moves,
         &Board::king_moves
     };
+    // non-pawn, non-king pieces only ever move onto target_mask, so they are shared
+    static constexpr void (Board::*CALCULATE_CAPTURES_FUNCTIONS[])(uint8_t) = {
+        &Board::pawn_captures,
+        &Board::knight_moves,
+        &Board::bishop_moves,
+        &Board::rook_moves,
+        &Board::queen_moves,
+        &Board::king_captures
+    };
     static constexpr void (Board::*CALCULATE_CONTROLLED_FUNCTIONS[])(uint8_t) = {
         &Board::pawn_controlled,
         &Board::knight_controlled,
@@ -230,6 +591,7 @@ private:
         &Board::queen_controlled,
         &Board::king_controlled
     };
+#endif
     static constexpr Bitboard KINGSIDE_CASTLE[2] = {
         Bitboard(1ULL << F1) | Bitboard(1ULL << G1),
         Bitboard(1ULL << F8) | Bitboard(1ULL << G8),
@@ -238,7 +600,14 @@ private:
         Bitboard(1ULL << D1) | Bitboard(1ULL << C1) | Bitboard(1ULL << B1),
         Bitboard(1ULL << D8) | Bitboard(1ULL << C8) | Bitboard(1ULL << B8),
     };
+    static constexpr Bitboard QUEENSIDE_ROOK_PATH[2] = {
+        Bitboard(1ULL << B1),
+        Bitboard(1ULL << B8),
+    };
     
+    // exchange values, the king outweighs anything it could capture
+    static constexpr int SEE_VALUES[6] = {100, 300, 320, 500, 900, 20000};
+
     // Common calculation constants
     static constexpr int PAWN_START_RANK_WHITE = 1;
     static constexpr int PAWN_START_RANK_BLACK = 6;
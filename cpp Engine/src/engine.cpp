@@ -1,84 +1,417 @@
 #include "engine.hpp"
-#include <random>
+#include <algorithm>
+#include <array>
+#include <cmath>
 
-Engine::Engine(Board* board) : board(board) {}
+Engine::Engine(Board* board) : Engine(board, std::make_shared<TranspositionTable>(), 0) {}
+
+Engine::Engine(Board* board, std::shared_ptr<TranspositionTable> tt, const int thread_id)
+    : board(board), tt(std::move(tt)), thread_id(thread_id) {}
+
+Engine::~Engine() {
+    stop();
+    wait();
+}
+
+void Engine::set_hash_size(size_t size_mb) {
+    tt->resize(size_mb);
+}
+
+void Engine::new_game() {
+    tt->clear();
+    clear_heuristics();
+    pawn_table.clear();
+    for (auto& helper : helpers) {
+        helper->clear_heuristics();
+        helper->pawn_table.clear();
+    }
+}
+
+void Engine::new_search() {
+    std::fill(&killers[0][0], &killers[0][0] + sizeof(killers) / sizeof(Move), Move{});
+    // what was learned last move still mostly holds, but shouldn't drown out what comes next
+    for (auto& side : history) {
+        for (auto& from : side) {
+            for (int& score : from) score /= 2;
+        }
+    }
+    pawn_table.reset_stats();
+}
+
+void Engine::clear_heuristics() {
+    std::fill(&history[0][0][0], &history[0][0][0] + sizeof(history) / sizeof(int), 0);
+    std::fill(&countermoves[0][0], &countermoves[0][0] + sizeof(countermoves) / sizeof(Move), Move{});
+}
+
+void Engine::set_threads(int count) {
+    count = std::clamp(count, 1, MAX_THREADS);
+    helpers.clear();
+    helper_boards.clear();
+    for (int i = 1; i < count; ++i) {
+        helper_boards.push_back(std::make_unique<Board>(*board));
+        helpers.push_back(std::unique_ptr<Engine>(new Engine(helper_boards.back().get(), tt, i)));
+        helpers.back()->options = options;
+    }
+}
+
+void Engine::set_search_options(const SearchOptions& search_options) {
+    options = search_options;
+    for (auto& helper : helpers) helper->options = search_options;
+}
+
+uint64_t Engine::get_nodes() const {
+    uint64_t total = nodes.load(std::memory_order_relaxed);
+    for (const auto& helper : helpers) total += helper->nodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t Engine::get_qnodes() const {
+    uint64_t total = qnodes.load(std::memory_order_relaxed);
+    for (const auto& helper : helpers) total += helper->qnodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t Engine::get_pawn_probes() const {
+    uint64_t total = pawn_table.get_probes();
+    for (const auto& helper : helpers) total += helper->pawn_table.get_probes();
+    return total;
+}
+
+uint64_t Engine::get_pawn_hits() const {
+    uint64_t total = pawn_table.get_hits();
+    for (const auto& helper : helpers) total += helper->pawn_table.get_hits();
+    return total;
+}
 
 Move Engine::get_best_move(int depth) {
+    SearchLimits depth_limits;
+    depth_limits.depth = depth;
+    return think(depth_limits);
+}
 
-    std::vector moves = board->get_moves();
-    if (moves.empty()) return Move{};
+Move Engine::think(const SearchLimits& search_limits) {
+    limits = search_limits;
+    stopped = false;
+    stop_requested = false;
+    pondering = limits.ponder;
+    return iterative_deepening();
+}
 
-    best_moves.clear();
-    int best_score = -MATE;
+void Engine::think_async(const SearchLimits& search_limits, BestMoveCallback on_best_move) {
+    wait();
+
+    // reset the flags here so a stop sent right after go is never lost
+    limits = search_limits;
+    stopped = false;
+    stop_requested = false;
+    pondering = limits.ponder;
+    search_thread = std::thread([this, on_best_move]() {
+        const Move best = iterative_deepening();
+        on_best_move(best, ponder_move(best));
+    });
+}
+
+void Engine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        stop_requested = true;
+    }
+    wait_cv.notify_all();
+}
+
+void Engine::ponderhit() {
+    // our clock starts now, the time spent pondering was free
+    time_manager.restart();
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        pondering = false;
+    }
+    wait_cv.notify_all();
+}
+
+void Engine::wait() {
+    if (search_thread.joinable()) search_thread.join();
+}
+
+void Engine::wait_for_stop() {
+    std::unique_lock<std::mutex> lock(wait_mutex);
+    wait_cv.wait(lock, [this]() { return stop_requested || (!pondering && !limits.infinite); });
+}
+
+Move Engine::ponder_move(Move best) {
+    if (!best.move) return Move{};
+    if (pv.size() > 1 && pv[0].move == best.move) return pv[1];
+
+    // otherwise the reply stored in the TT, if it is legal
+    Move reply;
+    TTData tt_data;
+    board->make_move(&best);
+    if (tt->probe(board->hash(), tt_data)) {
+        MoveList replies;
+        board->generate(replies);
+        for (const Move& move : replies) {
+            if (move.move == tt_data.move.move) reply = move;
+        }
+    }
+    board->undo_move();
+    return reply;
+}
+
+Move Engine::iterative_deepening() {
+
+    MoveList moves;
+    board->generate(moves);
+    if (moves.empty()) {
+        wait_for_stop();
+        return Move{};
+    }
+
+    time_manager.init(limits, board->get_turn());
+    nodes = 0;
+    qnodes = 0;
+    tt->new_search();
+    new_search();
+
+    std::vector<std::thread> helper_threads;
+    for (size_t i = 0; i < helpers.size(); ++i) {
+        *helper_boards[i] = *board;
+        helpers[i]->stopped = false;
+        helpers[i]->nodes = 0;
+        helpers[i]->qnodes = 0;
+        helpers[i]->new_search();
+        helper_threads.emplace_back(&Engine::helper_search, helpers[i].get());
+    }
+
+    // iterative deepening, keeping the principal variation of the last completed iteration
+    pv.assign(1, moves[0]);
+    last_info_ms = 0;
+    int score = 0;
+    const int max_depth = (limits.depth > 0) ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        root_depth = depth;
+        seldepth = 0;
+        score = aspiration_search(moves, depth, score);
+        if (stopped) break;
+        if (pv_length[0] > 0) pv.assign(pv_table[0], pv_table[0] + pv_length[0]);
+        report(score);
+
+        if (stop_requested) break;
+        if (pondering) continue;
+        if (score == MATE - 1) break;
+        if (moves.size() == 1 && limits.use_time()) break;
+        if (!time_manager.can_start_iteration()) break;
+    }
+
+    // infinite and ponder searches may only report once told to
+    wait_for_stop();
+
+    for (auto& helper : helpers) helper->stopped = true;
+    for (auto& thread : helper_threads) thread.join();
+
+    return pv[0];
+}
+
+void Engine::helper_search() {
+    MoveList moves;
+    board->generate(moves);
+
+    // odd helpers start one ply deeper so the threads spread over neighbouring depths
+    int score = 0;
+    for (int depth = 1 + thread_id % 2; depth <= MAX_DEPTH; ++depth) {
+        score = aspiration_search(moves, depth, score);
+        if (stopped) break;
+    }
+}
+
+int Engine::aspiration_search(MoveList& moves, const int depth, const int previous) {
+    // a window around the last score fails fast on the moves that can't beat it
+    int delta = ASPIRATION_WINDOW;
     int alpha = -MATE, beta = MATE;
-    for (auto& move : moves) {
-        board->make_move(&move);
-        int score = -minimax(depth - 1, alpha, beta);
-        board->undo_move();
+    if (depth >= ASPIRATION_DEPTH && std::abs(previous) < MATE_BOUND) {
+        alpha = std::max(previous - delta, -MATE);
+        beta = std::min(previous + delta, MATE);
+    }
 
-        std::cout << "move: " << move.to_uci() << " score: " << score << "\n";
+    while (true) {
+        const int score = search_root(moves, depth, alpha, beta);
+        if (stopped) return score;
+
+        // widen the side the score fell out of and search again
+        if (score <= alpha) {
+            beta = (alpha + beta) / 2;
+            alpha = std::max(score - delta, -MATE);
+        } else if (score >= beta) {
+            beta = std::min(score + delta, MATE);
+        } else {
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+int Engine::search_root(MoveList& moves, const int depth, int alpha, const int beta) {
+    pv_length[0] = 0;
+    int best_score = -MATE;
+    Move best_move;
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        root_move = move;
+        root_move_number = i + 1;
+        make(move, 0);
+        int score;
+        if (i == 0) {
+            score = -minimax(depth - 1, 1, -beta, -alpha);
+        } else {
+            // the rest only have to prove they are no better than the best so far
+            score = -minimax(depth - 1, 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) score = -minimax(depth - 1, 1, -beta, -alpha);
+        }
+        unmake(0);
+        if (stopped) return best_score;
 
         if (score > best_score) {
             best_score = score;
-            best_moves.clear();
-            best_moves.push_back(move);
-            if (score == MATE) {
-                break;
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+                update_pv(0, move);
+
+                // the best move goes first for the re-search and the next iteration
+                std::rotate(moves.begin(), moves.begin() + i, moves.begin() + i + 1);
+                if (score >= beta || score == MATE - 1) break;
             }
-        } else if (score == best_score) {
-            best_moves.push_back(move);
         }
+    }
+    if (best_move.move) {
+        tt->store(board->hash(), depth, score_to_tt(best_score, 0), best_score >= beta ? BOUND_LOWER : BOUND_EXACT, best_move);
+    }
+    return best_score;
+}
 
-        // alpha = std::max(score, alpha);
+void Engine::update_pv(const int ply, const Move move) {
+    pv_table[ply][ply] = move;
+    for (int i = ply + 1; i < pv_length[ply + 1]; ++i) {
+        pv_table[ply][i] = pv_table[ply + 1][i];
     }
+    pv_length[ply] = pv_length[ply + 1];
+}
 
-    std::cout << "BEST MOVES:" << std::endl;
-    for (auto& move : best_moves) {
-        std::cout << "\t" << move.to_uci() << "\n";
+void Engine::check_limits() {
+    // depth 1 is never cut short, so there is always a searched move to play
+    if (root_depth > 1) {
+        if (stop_requested) stopped = true;
+        if (limits.nodes && get_nodes() >= limits.nodes) stopped = true;
+        if (!pondering && time_manager.out_of_time()) stopped = true;
     }
+    if (on_info && time_manager.elapsed() - last_info_ms >= INFO_INTERVAL_MS) report_progress();
+}
 
-    if (best_moves.size() == 1) return best_moves[0];
+void Engine::report(const int score) {
+    if (!on_info) return;
+    SearchInfo info;
+    info.depth = root_depth;
+    info.seldepth = seldepth;
+    info.score = score;
+    if (score >= MATE_BOUND) info.mate_in = (MATE - score + 1) / 2;
+    else if (score <= -MATE_BOUND) info.mate_in = -(MATE + score) / 2;
+    info.nodes = get_nodes();
+    info.time = time_manager.elapsed();
+    info.nps = info.nodes * 1000 / std::max<int64_t>(info.time, 1);
+    info.hashfull = tt->hashfull();
+    info.pv = pv;
+    last_info_ms = info.time;
+    on_info(info);
+}
 
-    static thread_local std::mt19937 rng(std::random_device{}());
-    static thread_local std::uniform_int_distribution<size_t> dist;
-    dist.param(std::uniform_int_distribution<size_t>::param_type(0, best_moves.size() - 1));
-    return best_moves[dist(rng)];
+void Engine::report_progress() {
+    SearchInfo info;
+    info.depth = root_depth;
+    info.seldepth = seldepth;
+    info.nodes = get_nodes();
+    info.time = time_manager.elapsed();
+    info.nps = info.nodes * 1000 / std::max<int64_t>(info.time, 1);
+    info.hashfull = tt->hashfull();
+    info.currmove = root_move;
+    info.currmove_number = root_move_number;
+    last_info_ms = info.time;
+    on_info(info);
 }
 
-int Engine::score_move(Move move) {
-    int end = move.end();
-    Piece move_piece = board->get_piece(move.start());
-    Piece end_piece = board->get_piece(end);
-    Piece promotion_piece = move.promotion_piece(board->get_turn());
-    Piece::PieceType move_piece_type = move_piece.get_piece();
-    Piece::PieceType end_piece_type = end_piece.get_piece();
-    Piece::PieceType promotion_piece_type = promotion_piece.get_piece();
+int Engine::score_move(const Move move, const int ply, const Move countermove) const {
+    const Piece::PieceType moved = board->get_piece(move.start()).get_piece();
+    const Piece captured = move.is_en_passant() ? Piece(Piece::PAWN) : board->get_piece(move.end());
 
-    int score = 0;
-    if (!end_piece.is_empty()) {
-        score += 10 * PIECE_VALUES[end_piece_type] - PIECE_VALUES[move_piece_type];
+    if (!captured.is_empty() || move.is_promotion()) {
+        // most valuable victim, least valuable attacker
+        int score = captured.is_empty() ? 0 : 10 * PSQT::MG_PIECE_VALUES[captured.get_piece()] - PSQT::MG_PIECE_VALUES[moved];
+        if (move.is_promotion()) score += PSQT::MG_PIECE_VALUES[move.promotion_piece(board->get_turn()).get_piece()];
+        // captures that lose material in the exchange on their square go after the quiet moves
+        return score + (board->see_ge(move, 0) ? GOOD_CAPTURE_SCORE : BAD_CAPTURE_SCORE);
     }
-    if (!promotion_piece.is_empty()) {
-        score += PIECE_VALUES[promotion_piece_type];
+
+    if (move.move == killers[ply][0].move) return KILLER_SCORE;
+    if (move.move == killers[ply][1].move) return KILLER_SCORE - 1;
+    if (move.move == countermove.move) return COUNTERMOVE_SCORE;
+    return history[board->get_turn()][move.start()][move.end()];
+}
+
+void Engine::score_moves(const MoveList& moves, int* scores, const int ply, const Move tt_move) const {
+    const Move countermove = last_move().move ? countermoves[last_move().start()][last_move().end()] : Move{};
+    for (int i = 0; i < moves.size(); ++i) {
+        scores[i] = (moves[i].move == tt_move.move) ? HASH_MOVE_SCORE : score_move(moves[i], ply, countermove);
     }
-    if (board->is_controlled(end)) {
-        score -= PIECE_VALUES[move_piece_type];
+}
+
+Move Engine::pick_move(MoveList& moves, int* scores, const int index) {
+    // one step of a selection sort, so a cutoff early on never pays for ordering the rest
+    int best = index;
+    for (int i = index + 1; i < moves.size(); ++i) {
+        if (scores[i] > scores[best]) best = i;
     }
-    return score;
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+    return moves[index];
+}
+
+Move Engine::last_move() const {
+    const int ply_count = board->get_ply_count();
+    return ply_count > 0 ? board->get_ply(ply_count - 1).move : Move{};
 }
 
-int Engine::search(int depth) {
-    if (depth == 0) {
-        return 1;
+void Engine::update_heuristics(const Move move, const int ply, const int depth, const Move* quiets_tried, const int quiet_count) {
+    if (move.move != killers[ply][0].move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
     }
-    int ret = 0;
-    std::vector<Move> moves = board->get_moves();
-    for (const Move& move : moves) {
-        board->make_move(&move);
-        ret += search(depth - 1);
-        board->undo_move();
+    const Move previous = last_move();
+    if (previous.move) countermoves[previous.start()][previous.end()] = move;
+
+    // the move that cut gains, the quiet moves tried before it lose the same
+    const Turn turn = board->get_turn();
+    const int bonus = std::min(depth * depth, HISTORY_MAX);
+    update_history(history[turn][move.start()][move.end()], bonus);
+    for (int i = 0; i < quiet_count; ++i) {
+        update_history(history[turn][quiets_tried[i].start()][quiets_tried[i].end()], -bonus);
     }
-    return ret;
+}
+
+int Engine::lmr_reduction(const int depth, const int index) {
+    // grows with the log of both: a ply for move 4 at depth 3, four for move 30 at depth 12
+    static const auto table = [] {
+        std::array<std::array<int, MoveList::MAX_MOVES>, MAX_DEPTH + 1> reductions{};
+        for (int d = 1; d <= MAX_DEPTH; ++d) {
+            for (int i = 1; i < MoveList::MAX_MOVES; ++i) {
+                reductions[d][i] = static_cast<int>(0.75 + std::log(d) * std::log(i) / 2.25);
+            }
+        }
+        return reductions;
+    }();
+    return table[std::min(depth, MAX_DEPTH)][index];
+}
+
+void Engine::update_history(int& entry, const int bonus) {
+    // scaled down as it nears the limit, so entries stay within +-HISTORY_MAX
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
 }
 
 int Engine::evaluate() {
@@ -88,58 +421,208 @@ int Engine::evaluate() {
     } else if (game_state == GameState::DRAW) {
         return 0;
     }
+    return static_evaluate();
+}
 
-    int ret = 0;
+int Engine::static_evaluate() {
+    // the network when one is loaded, otherwise the material and piece-square values the board
+    // keeps up to date as pieces move plus the pawn structure, mostly from the pawn table
+    if (NNUE::is_loaded()) return board->nnue_score();
+    return PSQT::taper(board->psq_pair() + pawn_table.evaluate(*board), board->get_phase());
+}
 
-    // material values
-    for (int i = 0; i < 6; ++i) {
-        ret += __builtin_popcountll(board->friend_arr[i]) * PIECE_VALUES[i];
-        ret -= __builtin_popcountll(board->enemy_arr[i]) * PIECE_VALUES[i];
+void Engine::make(const Move& move, const int ply) {
+    if constexpr (Board::COPY_MAKE) {
+        board->make_move(&move, states[ply]);
+    } else {
+        board->make_move(&move);
     }
+}
 
-    // position values
-    auto flip = [](int sq){ return 63 - sq; };
-    Turn currentTurn = board->get_turn();
-    bool whiteToMove = (currentTurn == Turn::WHITE);
+void Engine::unmake(const int ply) {
+    if constexpr (Board::COPY_MAKE) {
+        board->undo_move(states[ply]);
+    } else {
+        board->undo_move();
+    }
+}
+
+void Engine::count_node() {
+    const uint64_t searched = nodes.load(std::memory_order_relaxed) + 1;
+    nodes.store(searched, std::memory_order_relaxed);
+    if (searched % CHECK_INTERVAL == 0 || searched == limits.nodes) check_limits();
+}
+
+int Engine::minimax(int depth, int ply, int alpha, int beta) {
+    pv_length[ply] = ply;
+    if (depth <= 0) return quiescence(ply, alpha, beta);
+
+    seldepth = std::max(seldepth, ply);
+    count_node();
+    if (stopped) return 0;
+    if (board->is_draw(ply)) return 0;
 
-    int sq;
-    for (int i = 0; i < 6; ++i) {
-        CTZLL_ITERATOR(sq, board->friend_arr[i]) {
-            ret += POSITION_VALUES[i][ whiteToMove ? sq : flip(sq) ];
+    // only null-window nodes take cutoffs from the table, so the PV is never cut short
+    const bool pv_node = beta - alpha > 1;
+    const int alpha_orig = alpha;
+    const uint64_t key = board->hash();
+    TTData tt_data;
+    Move tt_move;
+    if (tt->probe(key, tt_data)) {
+        tt_move = tt_data.move;
+        if (!pv_node && tt_data.depth >= depth) {
+            const int tt_score = score_from_tt(tt_data.score, ply);
+            if (tt_data.bound == BOUND_EXACT) return tt_score;
+            if (tt_data.bound == BOUND_LOWER && tt_score >= beta) return tt_score;
+            if (tt_data.bound == BOUND_UPPER && tt_score <= alpha) return tt_score;
         }
-        CTZLL_ITERATOR(sq, board->enemy_arr[i]) {
-            ret -= POSITION_VALUES[i][ whiteToMove ? flip(sq) : sq ];
+    }
+
+    // the static eval drives the pruning below, none of which is sound in check
+    const bool in_check = board->king_in_check();
+    const int eval = in_check ? -MATE + ply : static_evaluate();
+    if (!pv_node && !in_check) {
+        // reverse futility: so far above beta that the opponent isn't expected to get back
+        if (options.reverse_futility && depth <= REVERSE_FUTILITY_DEPTH && std::abs(beta) < MATE_BOUND
+            && eval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+            return eval;
+        }
+
+        // null move: if passing still holds beta, some real move will too. Not twice in a row,
+        // and not with only pawns left, where zugzwang makes passing the best move
+        if (options.null_move && depth >= NULL_MOVE_DEPTH && eval >= beta && last_move().move
+            && board->has_non_pawn_material(board->get_turn())) {
+            const int reduction = NULL_MOVE_REDUCTION + depth / 4;
+            board->make_null_move(states[ply]);
+            const int score = -minimax(depth - 1 - reduction, ply + 1, -beta, -beta + 1);
+            board->undo_move(states[ply]);
+            if (stopped) return 0;
+            // a mate found after passing proves nothing about the position itself
+            if (score >= beta) return score >= MATE_BOUND ? beta : score;
         }
     }
 
-    return ret;
-}
+    MoveList moves;
+    board->generate(moves);
+    if (moves.empty()) {
+        return in_check ? -MATE + ply : 0;
+    }
+
+    // futility: this close to the leaves a quiet move won't make up the gap to alpha
+    const bool futile = options.futility && !pv_node && !in_check && depth <= FUTILITY_DEPTH
+        && std::abs(alpha) < MATE_BOUND && eval + FUTILITY_MARGIN * depth <= alpha;
+    const Turn turn = board->get_turn();
 
-int Engine::minimax(int depth, int alpha, int beta) {
-    if (depth == 0) {
-        return evaluate();
+    // hash move, good captures, killers, countermove, quiets by history, bad captures
+    int scores[MoveList::MAX_MOVES];
+    score_moves(moves, scores, ply, tt_move);
+
+    int best_score = -MATE;
+    Move best_move;
+    Move quiets_tried[MoveList::MAX_MOVES];
+    int quiet_count = 0;
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = pick_move(moves, scores, i);
+        const bool quiet = board->is_empty(move.end()) && !move.is_en_passant() && !move.is_promotion();
+        make(move, ply);
+        // checks are neither pruned nor reduced, they are how mates just past the horizon get found
+        const bool prunable = quiet && i > 0 && !in_check && !board->king_in_check();
+        if (futile && prunable) {
+            unmake(ply);
+            continue;
+        }
+        int score;
+        if (i == 0) {
+            score = -minimax(depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            // late quiet moves rarely turn out best: search them shallower, less so with a good history
+            int reduction = 0;
+            if (options.late_move_reductions && depth >= LMR_DEPTH && i >= LMR_FULL_DEPTH_MOVES && prunable) {
+                reduction = lmr_reduction(depth, i) - history[turn][move.start()][move.end()] / (HISTORY_MAX / 2) - pv_node;
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+
+            // null window first, the full one only if the move might be better
+            score = -minimax(depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+            if (reduction && score > alpha) score = -minimax(depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) score = -minimax(depth - 1, ply + 1, -beta, -alpha);
+        }
+        unmake(ply);
+        if (stopped) return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+                update_pv(ply, move);
+            }
+            if (score >= beta) {
+                if (quiet) update_heuristics(move, ply, depth, quiets_tried, quiet_count);
+                tt->store(key, depth, score_to_tt(score, ply), BOUND_LOWER, move);
+                return score;
+            }
+        }
+        if (quiet) quiets_tried[quiet_count++] = move;
     }
+    tt->store(key, depth, score_to_tt(best_score, ply), alpha > alpha_orig ? BOUND_EXACT : BOUND_UPPER, best_move);
+    return best_score;
+}
+
+int Engine::quiescence(int ply, int alpha, int beta) {
+    pv_length[ply] = ply;
+    seldepth = std::max(seldepth, ply);
+    count_node();
+    qnodes.store(qnodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (stopped) return 0;
+    if (ply >= MAX_PLY) return static_evaluate();
+
+    // in check every evasion is searched and standing pat is not an option, so the check test
+    // comes before generating and each node generates once
+    MoveList moves;
+    const bool in_check = board->king_in_check();
+    int stand_pat = -MATE + ply;
+    int best_score = stand_pat;
+    if (in_check) {
+        board->generate(moves);
+        if (moves.empty()) return -MATE + ply;
+    } else {
+        stand_pat = best_score = static_evaluate();
+        if (stand_pat >= beta) return stand_pat;
 
-    if (board->get_game_state() != GameState::IN_PROGRESS) {
-        return evaluate();
+        // not even winning a queen gets us back to alpha
+        const int optimistic = stand_pat + PSQT::MG_PIECE_VALUES[Piece::QUEEN] + DELTA_MARGIN;
+        if (optimistic <= alpha) return optimistic;
+        if (stand_pat > alpha) alpha = stand_pat;
+        board->generate_captures(moves);
     }
 
-    std::vector<Move> moves = board->get_moves();
-    std::sort(moves.begin(), moves.end(), 
-        [this](const Move& a, const Move& b) {
-        return score_move(a) > score_move(b);
-    });
+    int scores[MoveList::MAX_MOVES];
+    score_moves(moves, scores, ply, Move{});
 
     int score;
-    for (const Move& move : moves) {
-        board->make_move(&move);
-        score = -minimax(depth - 1, -beta, -alpha);
-        board->undo_move();
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = pick_move(moves, scores, i);
+        if (!in_check) {
+            // delta pruning: skip captures that can't raise the score to alpha
+            if (!move.is_promotion()) {
+                const Piece captured = move.is_en_passant() ? Piece(Piece::PAWN) : board->get_piece(move.end());
+                if (stand_pat + PSQT::MG_PIECE_VALUES[captured.get_piece()] + DELTA_MARGIN <= alpha) continue;
+            }
+            // and captures that lose material once the exchange is played out
+            if (!board->see_ge(move, 0)) continue;
+        }
+
+        make(move, ply);
+        score = -quiescence(ply + 1, -beta, -alpha);
+        unmake(ply);
+        if (stopped) return 0;
 
-        if (score >= beta) {
-            return beta;
+        if (score > best_score) {
+            best_score = score;
+            if (score >= beta) return score;
+            if (score > alpha) alpha = score;
         }
-        alpha = std::max(alpha, score);
     }
-    return alpha;
+    return best_score;
 }
@@ -1,88 +1,259 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "board.hpp"
+#include "pawns.hpp"
+#include "transposition_table.hpp"
+#include "time_manager.hpp"
+#include "psqt.hpp"
+
+/**
+ * @brief Switches for the selective parts of the search, all on by default.
+ */
+struct SearchOptions {
+    bool null_move = true;
+    bool late_move_reductions = true;
+    bool reverse_futility = true;
+    bool futility = true;
+};
 
+/**
+ * @brief A progress report from the search, carrying what a UCI info line does.
+ *
+ * Reports at the end of an iteration have a score and a PV. Periodic reports in between have
+ * the root move being searched instead.
+ */
+struct SearchInfo {
+    int depth = 0;
+    int seldepth = 0;
+    // centipawns from the side to move's view, unless mate_in is set
+    int score = 0;
+    // moves until mate, negative when being mated, 0 if no mate was found
+    int mate_in = 0;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    int hashfull = 0;
+    int64_t time = 0;
+    Move currmove;
+    int currmove_number = 0;
+    std::vector<Move> pv;
+};
 
 class Engine {
     public:
         Engine(Board* board);
-        int search(int depth);
+        ~Engine();
         Move get_best_move(int depth);
+        Move think(const SearchLimits& limits);
         int evaluate();
+        void set_hash_size(size_t size_mb);
+        void new_game();
+
+        /**
+         * @brief Sets how many threads search together, sharing the transposition table.
+         *
+         * @param count The number of threads including the main one.
+         */
+        void set_threads(int count);
+        int get_threads() const { return static_cast<int>(helpers.size()) + 1; }
+
+        /**
+         * @brief Turns the pruning and reduction techniques on or off, for every thread.
+         */
+        void set_search_options(const SearchOptions& options);
+        const SearchOptions& get_search_options() const { return options; }
+
+        /**
+         * @brief Returns the nodes searched by all threads in the current or last search.
+         */
+        uint64_t get_nodes() const;
+
+        /**
+         * @brief Returns how many of those nodes were quiescence nodes.
+         */
+        uint64_t get_qnodes() const;
+
+        /**
+         * @brief Returns how many pawn table probes all threads made in the current or last
+         * search, and how many of them hit.
+         */
+        uint64_t get_pawn_probes() const;
+        uint64_t get_pawn_hits() const;
+
+        /**
+         * @brief Returns the milliseconds since the current or last search started.
+         */
+        int64_t get_elapsed() const { return time_manager.elapsed(); }
+
+        /**
+         * @brief Returns the principal variation of the last completed iteration.
+         */
+        const std::vector<Move>& get_pv() const { return pv; }
 
-        static const int MAX_DEPTH = 12;
-        static const int DEFAULT_DEPTH = 6;
+        // called from the searching thread with the best move and the expected reply, if known
+        using BestMoveCallback = std::function<void(Move best, Move ponder)>;
+
+        // called from the searching thread after each iteration and every INFO_INTERVAL_MS
+        using InfoCallback = std::function<void(const SearchInfo& info)>;
+
+        /**
+         * @brief Sets where progress reports go, none are made without one.
+         */
+        void set_info_callback(InfoCallback on_info) { this->on_info = std::move(on_info); }
+
+        /**
+         * @brief Starts a search on a worker thread and returns immediately.
+         *
+         * Infinite and ponder searches keep the result until stop() or ponderhit().
+         */
+        void think_async(const SearchLimits& limits, BestMoveCallback on_best_move);
+
+        /**
+         * @brief Asks the running search to finish as soon as possible.
+         *
+         * Depth 1 always completes first, so the search has a move and a score to report.
+         */
+        void stop();
+
+        /**
+         * @brief Switches a ponder search to a normal search on our own clock.
+         */
+        void ponderhit();
+
+        /**
+         * @brief Blocks until the worker thread, if any, has finished.
+         */
+        void wait();
+
+        static constexpr int MAX_DEPTH = 64;
+        static constexpr int DEFAULT_DEPTH = 6;
+        static constexpr int MAX_PLY = 128;
+        static constexpr int MAX_THREADS = 256;
 
     private:
+        // helper threads search their own copy of the board and share the table of the main one
+        Engine(Board* board, std::shared_ptr<TranspositionTable> tt, int thread_id);
+
         Board* board;
-        std::vector<Move> best_moves;
-
-        int minimax(int depth, int alpha, int beta);
-        int score_move(Move move);
-
-        const int MATE = 100000;
-        const int PIECE_VALUES[6] = {100, 300, 320, 500, 900, 0};
-        const int POSITION_VALUES[6][64] = 
-        {
-            {
-                0,   0,   0,   0,   0,   0,   0,   0,
-                5,  10,  10, -20, -20,  10,  10,   5,
-                5,  -5, -10,   0,   0, -10,  -5,   5,
-                0,   0,   0,  20,  20,   0,   0,   0,
-                5,   5,  10,  25,  25,  10,   5,   5,
-                10,  10,  20,  30,  30,  20,  10,  10,
-                50,  50,  50,  50,  50,  50,  50,  50,
-                0,   0,   0,   0,   0,   0,   0,   0
-            },
-            {
-                -50,-40,-30,-30,-30,-30,-40,-50,
-                -40,-20,  0,  5,  5,  0,-20,-40,
-                -30,  5, 10, 15, 15, 10,  5,-30,
-                -30,  0, 15, 20, 20, 15,  0,-30,
-                -30,  5, 15, 20, 20, 15,  5,-30,
-                -30,  0, 10, 15, 15, 10,  0,-30,
-                -40,-20,  0,  0,  0,  0,-20,-40,
-                -50,-40,-30,-30,-30,-30,-40,-50,
-            },
-            {
-                -20,-10,-10,-10,-10,-10,-10,-20,
-                -10,  5,  0,  0,  0,  0,  5,-10,
-                -10, 10, 10, 10, 10, 10, 10,-10,
-                -10,  0, 10, 10, 10, 10,  0,-10,
-                -10,  5,  5, 10, 10,  5,  5,-10,
-                -10,  0,  5, 10, 10,  5,  0,-10,
-                -10,  0,  0,  0,  0,  0,  0,-10,
-                -20,-10,-10,-10,-10,-10,-10,-20,
-            },
-            {
-                0,  0,  0,  0,  0,  0,  0,  0,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                5, 10, 10, 10, 10, 10, 10,  5,
-                0,  0,  0,  5,  5,  0,  0,  0
-            },
-            {
-                -20,-10,-10, -5, -5,-10,-10,-20,
-                -10,  0,  5,  0,  0,  0,  0,-10,
-                -10,  5,  5,  5,  5,  5,  0,-10,
-                0,    0,  5,  5,  5,  5,  0, -5,
-                -5,   0,  5,  5,  5,  5,  0, -5,
-                -10,  0,  5,  5,  5,  5,  0,-10,
-                -10,  0,  0,  0,  0,  0,  0,-10,
-                -20,-10,-10, -5, -5,-10,-10,-20
-            },
-            {
-            -80, -70, -70, -70, -70, -70, -70, -80, 
-            20,  20,  -5,  -5,  -5,  -5,  20,  20, 
-            -10, -20, -20, -20, -20, -20, -20, -10, 
-            -20, -30, -30, -40, -40, -30, -30, -20, 
-            -30, -40, -40, -50, -50, -40, -40, -30, 
-            -40, -50, -50, -60, -60, -50, -50, -40, 
-            -60, -60, -60, -60, -60, -60, -60, -60, 
-            20,  30,  10,   0,   0,  10,  30,  20
-            }
-        };
+        std::vector<Move> pv;
+        std::shared_ptr<TranspositionTable> tt;
+        // each thread caches its own pawn evaluations
+        PawnTable pawn_table;
+        TimeManager time_manager;
+        SearchLimits limits;
+        SearchOptions options;
+        // only written by the searching thread, relaxed so others can sum it
+        std::atomic<uint64_t> nodes = 0;
+        std::atomic<uint64_t> qnodes = 0;
+        std::atomic<bool> stopped = false;
+        // set by stop(), and turned into stopped once depth 1 is done
+        std::atomic<bool> stop_requested = false;
+        std::atomic<bool> pondering = false;
+        std::thread search_thread;
+        std::mutex wait_mutex;
+        std::condition_variable wait_cv;
+
+        // progress reporting, main thread only
+        InfoCallback on_info;
+        int64_t last_info_ms = 0;
+        int root_depth = 0;
+        int seldepth = 0;
+        Move root_move;
+        int root_move_number = 0;
+
+        // Lazy SMP: helpers run the same search unsynchronized and meet in the table
+        int thread_id = 0;
+        std::vector<std::unique_ptr<Board>> helper_boards;
+        std::vector<std::unique_ptr<Engine>> helpers;
+
+        // copy-make builds save the board here before each move, one slot per ply
+        BoardState states[MAX_PLY];
+
+        // move ordering, learned from the moves that caused beta cutoffs
+        Move killers[MAX_PLY][2];
+        int history[2][64][64] = {};
+        Move countermoves[64][64];
+
+        // triangular PV: row ply holds the best line found from that ply, up to pv_length[ply]
+        Move pv_table[MAX_PLY + 1][MAX_PLY + 1];
+        int pv_length[MAX_PLY + 1];
+
+        // how many nodes to search between polls of the clock
+        static constexpr uint64_t CHECK_INTERVAL = 2048;
+
+        // how often a long iteration reports its progress in between
+        static constexpr int64_t INFO_INTERVAL_MS = 1000;
+
+        // a capture that can't lift the score to alpha even with this much to spare is skipped
+        static constexpr int DELTA_MARGIN = 200;
+
+        // ordering score bands: each kind of move sorts ahead of the next, quiets use their history
+        static constexpr int HASH_MOVE_SCORE = 1 << 30;
+        static constexpr int GOOD_CAPTURE_SCORE = 1 << 28;
+        static constexpr int KILLER_SCORE = 1 << 27;
+        static constexpr int COUNTERMOVE_SCORE = KILLER_SCORE - 2;
+        static constexpr int HISTORY_MAX = 1 << 14;
+        static constexpr int BAD_CAPTURE_SCORE = -(1 << 28);
+
+        // iterations from this depth on search a window this wide on each side of the last score
+        static constexpr int ASPIRATION_DEPTH = 4;
+        static constexpr int ASPIRATION_WINDOW = 25;
+
+        // null move: tried from this depth on, searched this many plies shallower plus one per 4 plies
+        static constexpr int NULL_MOVE_DEPTH = 3;
+        static constexpr int NULL_MOVE_REDUCTION = 3;
+
+        // reverse futility: up to this depth, a static eval this far above beta per ply is trusted
+        static constexpr int REVERSE_FUTILITY_DEPTH = 6;
+        static constexpr int REVERSE_FUTILITY_MARGIN = 80;
+
+        // futility: up to this depth, quiet moves are skipped if the static eval is this far below alpha per ply
+        static constexpr int FUTILITY_DEPTH = 3;
+        static constexpr int FUTILITY_MARGIN = 120;
+
+        // late move reductions: from this depth on, quiet moves after the first few are searched shallower
+        static constexpr int LMR_DEPTH = 3;
+        static constexpr int LMR_FULL_DEPTH_MOVES = 3;
+
+        Move iterative_deepening();
+        void helper_search();
+        Move ponder_move(Move best);
+        void wait_for_stop();
+        int aspiration_search(MoveList& moves, int depth, int previous);
+        int search_root(MoveList& moves, int depth, int alpha, int beta);
+        void update_pv(int ply, Move move);
+        int minimax(int depth, int ply, int alpha, int beta);
+        int quiescence(int ply, int alpha, int beta);
+        void make(const Move& move, int ply);
+        void unmake(int ply);
+        void count_node();
+        void check_limits();
+        void report(int score);
+        void report_progress();
+        int static_evaluate();
+        void new_search();
+        void clear_heuristics();
+        int score_move(Move move, int ply, Move countermove) const;
+        void score_moves(const MoveList& moves, int* scores, int ply, Move tt_move) const;
+        static Move pick_move(MoveList& moves, int* scores, int index);
+        Move last_move() const;
+        void update_heuristics(Move move, int ply, int depth, const Move* quiets_tried, int quiet_count);
+        static void update_history(int& entry, int bonus);
+        static int lmr_reduction(int depth, int index);
+
+        // mate scores are MATE minus the distance from the root in plies
+        static constexpr int MATE = 100000;
+        static constexpr int MATE_BOUND = MATE - MAX_PLY;
+        static constexpr int score_to_tt(const int score, const int ply) {
+            return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+        }
+        static constexpr int score_from_tt(const int score, const int ply) {
+            return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+        }
 };
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+// Generated by chessli-tune from a dataset of scored positions; hand edits are fine too, the
+// tuner starts from whatever is here.
+struct EvalWeights {
+/**
+ * @brief Every weight of the static evaluation, a middlegame and an endgame value each.
+ *
+ * Tables are laid out from white's side with A1 first. PSQT packs the material and
+ * piece-square weights, PawnTable the pawn structure ones.
+ */
+    static constexpr int MG_PIECE_VALUES[6] = {100, 300, 320, 500, 900, 0};
+    static constexpr int EG_PIECE_VALUES[6] = {120, 290, 310, 520, 940, 0};
+
+    static constexpr int MG_POSITION_VALUES[6][64] = {
+        {
+               0,   0,   0,   0,   0,   0,   0,   0,
+               5,  10,  10, -20, -20,  10,  10,   5,
+               5,  -5, -10,   0,   0, -10,  -5,   5,
+               0,   0,   0,  20,  20,   0,   0,   0,
+               5,   5,  10,  25,  25,  10,   5,   5,
+              10,  10,  20,  30,  30,  20,  10,  10,
+              50,  50,  50,  50,  50,  50,  50,  50,
+               0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        {
+             -50, -40, -30, -30, -30, -30, -40, -50,
+             -40, -20,   0,   5,   5,   0, -20, -40,
+             -30,   5,  10,  15,  15,  10,   5, -30,
+             -30,   0,  15,  20,  20,  15,   0, -30,
+             -30,   5,  15,  20,  20,  15,   5, -30,
+             -30,   0,  10,  15,  15,  10,   0, -30,
+             -40, -20,   0,   0,   0,   0, -20, -40,
+             -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        {
+             -20, -10, -10, -10, -10, -10, -10, -20,
+             -10,   5,   0,   0,   0,   0,   5, -10,
+             -10,  10,  10,  10,  10,  10,  10, -10,
+             -10,   0,  10,  10,  10,  10,   0, -10,
+             -10,   5,   5,  10,  10,   5,   5, -10,
+             -10,   0,   5,  10,  10,   5,   0, -10,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        {
+               0,   0,   0,   0,   0,   0,   0,   0,
+              -5,   0,   0,   0,   0,   0,   0,  -5,
+              -5,   0,   0,   0,   0,   0,   0,  -5,
+              -5,   0,   0,   0,   0,   0,   0,  -5,
+              -5,   0,   0,   0,   0,   0,   0,  -5,
+              -5,   0,   0,   0,   0,   0,   0,  -5,
+               5,  10,  10,  10,  10,  10,  10,   5,
+               0,   0,   0,   5,   5,   0,   0,   0,
+        },
+        {
+             -20, -10, -10,  -5,  -5, -10, -10, -20,
+             -10,   0,   5,   0,   0,   0,   0, -10,
+             -10,   5,   5,   5,   5,   5,   0, -10,
+               0,   0,   5,   5,   5,   5,   0,  -5,
+              -5,   0,   5,   5,   5,   5,   0,  -5,
+             -10,   0,   5,   5,   5,   5,   0, -10,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        {
+             -80, -70, -70, -70, -70, -70, -70, -80,
+              20,  20,  -5,  -5,  -5,  -5,  20,  20,
+             -10, -20, -20, -20, -20, -20, -20, -10,
+             -20, -30, -30, -40, -40, -30, -30, -20,
+             -30, -40, -40, -50, -50, -40, -40, -30,
+             -40, -50, -50, -60, -60, -50, -50, -40,
+             -60, -60, -60, -60, -60, -60, -60, -60,
+              20,  30,  10,   0,   0,  10,  30,  20,
+        },
+    };
+
+    static constexpr int EG_POSITION_VALUES[6][64] = {
+        {
+               0,   0,   0,   0,   0,   0,   0,   0,
+               5,   5,   5,   5,   5,   5,   5,   5,
+               5,   5,   5,   5,   5,   5,   5,   5,
+              15,  15,  15,  15,  15,  15,  15,  15,
+              30,  30,  30,  30,  30,  30,  30,  30,
+              55,  55,  55,  55,  55,  55,  55,  55,
+              90,  90,  90,  90,  90,  90,  90,  90,
+               0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        {
+             -50, -40, -30, -30, -30, -30, -40, -50,
+             -40, -20,   0,   0,   0,   0, -20, -40,
+             -30,   0,  10,  15,  15,  10,   0, -30,
+             -30,   5,  15,  20,  20,  15,   5, -30,
+             -30,   5,  15,  20,  20,  15,   5, -30,
+             -30,   0,  10,  15,  15,  10,   0, -30,
+             -40, -20,   0,   0,   0,   0, -20, -40,
+             -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        {
+             -20, -10, -10, -10, -10, -10, -10, -20,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -10,   0,   5,  10,  10,   5,   0, -10,
+             -10,   0,  10,  10,  10,  10,   0, -10,
+             -10,   0,  10,  10,  10,  10,   0, -10,
+             -10,   0,   5,  10,  10,   5,   0, -10,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        {
+               0,   0,   0,   0,   0,   0,   0,   0,
+               0,   0,   0,   0,   0,   0,   0,   0,
+               0,   0,   0,   0,   0,   0,   0,   0,
+               0,   0,   0,   0,   0,   0,   0,   0,
+               0,   0,   0,   0,   0,   0,   0,   0,
+               0,   0,   0,   0,   0,   0,   0,   0,
+              10,  10,  10,  10,  10,  10,  10,  10,
+               0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        {
+             -20, -10, -10,  -5,  -5, -10, -10, -20,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -10,   0,   5,   5,   5,   5,   0, -10,
+              -5,   0,   5,  10,  10,   5,   0,  -5,
+              -5,   0,   5,  10,  10,   5,   0,  -5,
+             -10,   0,   5,   5,   5,   5,   0, -10,
+             -10,   0,   0,   0,   0,   0,   0, -10,
+             -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        {
+             -50, -30, -30, -30, -30, -30, -30, -50,
+             -30, -30,   0,   0,   0,   0, -30, -30,
+             -30, -10,  20,  30,  30,  20, -10, -30,
+             -30, -10,  30,  40,  40,  30, -10, -30,
+             -30, -10,  30,  40,  40,  30, -10, -30,
+             -30, -10,  20,  30,  30,  20, -10, -30,
+             -30, -20, -10,   0,   0, -10, -20, -30,
+             -50, -40, -30, -20, -20, -30, -40, -50,
+        },
+    };
+
+    // pawn structure, per pawn from its own side's view
+    static constexpr int MG_DOUBLED_PAWN = -10;
+    static constexpr int EG_DOUBLED_PAWN = -20;
+    static constexpr int MG_ISOLATED_PAWN = -12;
+    static constexpr int EG_ISOLATED_PAWN = -15;
+    static constexpr int MG_BACKWARD_PAWN = -8;
+    static constexpr int EG_BACKWARD_PAWN = -10;
+
+    // by the rank of the pawn from its own side, then more for a passed pawn whose path is clear
+    static constexpr int MG_PASSED_PAWN[8] = {0, 5, 10, 15, 30, 50, 80, 0};
+    static constexpr int EG_PASSED_PAWN[8] = {0, 10, 15, 25, 45, 75, 120, 0};
+    static constexpr int MG_FREE_PASSED_PAWN[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    static constexpr int EG_FREE_PASSED_PAWN[8] = {0, 0, 5, 10, 20, 35, 60, 0};
+
+    // per file around the king: an own pawn one or two ranks in front of it, or none on the file
+    static constexpr int MG_PAWN_SHELTER[2] = {15, 8};
+    static constexpr int EG_PAWN_SHELTER[2] = {0, 0};
+    static constexpr int MG_SHELTER_MISSING = -15;
+    static constexpr int EG_SHELTER_MISSING = 0;
+};
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 #include <SFML/Graphics.hpp>
 #include <string>
@@ -5,6 +6,7 @@
 #include "board.hpp"
 #include "chess_ui.hpp"
 #include "engine.hpp"
+#include "perft.hpp"
 
 const int BOARD_SIZE = 8;
 const int SQUARE_SIZE = 60;
@@ -104,21 +106,23 @@ void run_test_mode(int max_depth) {
         std::cout << board.get_fen() << std::endl;
     }
     
-    // for (int depth = 1; depth <= max_depth; depth++) {
-    //     auto start = std::chrono::high_resolution_clock::now();
-    //     int result = engine.search(depth);
-    //     auto end = std::chrono::high_resolution_clock::now();
+    Perft perft;
+    Board start_board;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t result = perft.run(start_board, depth);
+        auto end = std::chrono::high_resolution_clock::now();
         
-    //     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         
-    //     std::cout << "Depth " << depth << ": " << result << " (";
-    //     if (duration.count() < 1000) {
-    //         std::cout << duration.count() << "ms";
-    //     } else {
-    //         std::cout << (duration.count() / 1000.0) << "s";
-    //     }
-    //     std::cout << ")\n";
-    // }
+        std::cout << "Depth " << depth << ": " << result << " (";
+        if (duration.count() < 1000) {
+            std::cout << duration.count() << "ms";
+        } else {
+            std::cout << (duration.count() / 1000.0) << "s";
+        }
+        std::cout << ")\n";
+    }
 }
 
 int main(int argc, char* argv[]) {
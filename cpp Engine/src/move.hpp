@@ -98,12 +98,3 @@ struct Move {
         return Move(start_sq, end_sq, flag);
     }
 };
-
-struct UnMove {
-    Move move;
-    Piece taken_piece;
-    Bitboard en_passant_square;
-    CastlingRights castling_rights;
-
-    UnMove(Move m, Piece t, Bitboard e, CastlingRights c) : move(m), taken_piece(t), en_passant_square(e), castling_rights(c) {}
-};
\ No newline at end of file
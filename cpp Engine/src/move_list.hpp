@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include "move.hpp"
+
+struct MoveList {
+/**
+ * @brief A fixed-capacity list of moves meant to live on the stack.
+ *
+ * No legal chess position has more than 218 moves, so 256 entries never overflow and move
+ * generation never touches the allocator. The entries are left uninitialized until a move is
+ * pushed, so constructing a list costs nothing.
+ */
+    static constexpr int MAX_MOVES = 256;
+
+    // in a union so the array skips Move's zeroing constructor
+    union {
+        Move moves[MAX_MOVES];
+    };
+    uint16_t count = 0;
+
+    MoveList() {}
+
+    /**
+     * @brief Appends a move to the list.
+     *
+     * @param move The move to append.
+     */
+    constexpr void push_back(const Move move) { moves[count++] = move; }
+
+    /**
+     * @brief Removes all moves from the list.
+     *
+     */
+    constexpr void clear() { count = 0; }
+
+    constexpr int size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+
+    constexpr Move& operator[](const int i) { return moves[i]; }
+    constexpr const Move& operator[](const int i) const { return moves[i]; }
+
+    // Iterators
+    constexpr Move* begin() { return moves; }
+    constexpr Move* end() { return moves + count; }
+    constexpr const Move* begin() const { return moves; }
+    constexpr const Move* end() const { return moves + count; }
+};
@@ -0,0 +1,253 @@
+#include "nnue.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+struct NNUE::Network {
+    alignas(64) int16_t ft_biases[L1];
+    alignas(64) int16_t ft_weights[INPUTS][L1];
+    alignas(64) int32_t l1_biases[L2];
+    alignas(64) int8_t l1_weights[L2][2 * L1];
+    alignas(64) int32_t l2_biases[L3];
+    alignas(64) int8_t l2_weights[L3][L2];
+    alignas(64) int32_t out_bias[1];
+    alignas(64) int8_t out_weights[1][L3];
+};
+
+std::unique_ptr<NNUE::Network> NNUE::network;
+
+template <typename T>
+static void read_array(std::ifstream& file, T* data, const size_t count, const std::string& path) {
+    file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    if (!file) throw std::runtime_error("Network file is truncated: " + path);
+}
+
+void NNUE::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open network file: " + path);
+
+    char magic[sizeof(MAGIC)];
+    uint32_t header[6];
+    read_array(file, magic, sizeof(MAGIC), path);
+    read_array(file, header, 6, path);
+    const uint32_t expected[6] = {VERSION, INPUTS, L1, L2, L3, 1};
+    if (!std::equal(magic, magic + sizeof(MAGIC), MAGIC)) {
+        throw std::runtime_error("Not a network file: " + path);
+    }
+    if (!std::equal(header, header + 6, expected)) {
+        throw std::runtime_error("Network file has a different version or layer sizes: " + path);
+    }
+
+    auto loaded = std::make_unique<Network>();
+    read_array(file, loaded->ft_biases, L1, path);
+    read_array(file, &loaded->ft_weights[0][0], static_cast<size_t>(INPUTS) * L1, path);
+    read_array(file, loaded->l1_biases, L2, path);
+    read_array(file, &loaded->l1_weights[0][0], L2 * 2 * L1, path);
+    read_array(file, loaded->l2_biases, L3, path);
+    read_array(file, &loaded->l2_weights[0][0], L3 * L2, path);
+    read_array(file, loaded->out_bias, 1, path);
+    read_array(file, &loaded->out_weights[0][0], L3, path);
+    if (file.peek() != std::ifstream::traits_type::eof()) {
+        throw std::runtime_error("Network file is longer than expected: " + path);
+    }
+    network = std::move(loaded);
+}
+
+void NNUE::unload() {
+    network.reset();
+}
+
+void NNUE::init_random(const uint32_t seed) {
+    std::mt19937 rng(seed);
+    auto fill = [&rng](auto* data, const size_t count, const int limit) {
+        std::uniform_int_distribution<int> dist(-limit, limit);
+        for (size_t i = 0; i < count; ++i) data[i] = static_cast<std::remove_reference_t<decltype(*data)>>(dist(rng));
+    };
+
+    auto random = std::make_unique<Network>();
+    fill(random->ft_biases, L1, 64);
+    fill(&random->ft_weights[0][0], static_cast<size_t>(INPUTS) * L1, 16);
+    fill(random->l1_biases, L2, 1024);
+    fill(&random->l1_weights[0][0], L2 * 2 * L1, 8);
+    fill(random->l2_biases, L3, 1024);
+    fill(&random->l2_weights[0][0], L3 * L2, 32);
+    fill(random->out_bias, 1, 1024);
+    fill(&random->out_weights[0][0], L3, 64);
+    network = std::move(random);
+}
+
+// the accumulator loops are left to the compiler, which vectorizes fixed-length int16 loops well
+
+void NNUE::init_accumulator(int16_t* values) {
+    std::copy(network->ft_biases, network->ft_biases + L1, values);
+}
+
+void NNUE::add_feature(int16_t* __restrict values, const int index) {
+    const int16_t* __restrict weights = network->ft_weights[index];
+    for (int i = 0; i < L1; ++i) values[i] += weights[i];
+}
+
+void NNUE::remove_feature(int16_t* __restrict values, const int index) {
+    const int16_t* __restrict weights = network->ft_weights[index];
+    for (int i = 0; i < L1; ++i) values[i] -= weights[i];
+}
+
+// clamps the accumulator to [0, ACTIVATION_MAX] and narrows it to bytes
+static void clipped_relu(const int16_t* input, uint8_t* output) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 32 <= NNUE::L1; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16));
+        // packs works per 128-bit lane, the permute puts the halves back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0b11011000);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_max_epi8(packed, zero));
+    }
+#elif defined(__SSSE3__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= NNUE::L1; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+        // SSE has no signed byte max, so clamp at the int16 stage before packing
+        const __m128i packed = _mm_packus_epi16(_mm_max_epi16(a, zero), _mm_max_epi16(b, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_min_epu8(packed, _mm_set1_epi8(NNUE::ACTIVATION_MAX)));
+    }
+#endif
+    for (; i < NNUE::L1; ++i) {
+        output[i] = static_cast<uint8_t>(std::clamp<int>(input[i], 0, NNUE::ACTIVATION_MAX));
+    }
+}
+
+// dot product of clipped activations and int8 weights; maddubs can't saturate since the
+// activations are at most 127
+template <int N>
+static int32_t dot(const uint8_t* input, const int8_t* weights) {
+#if defined(__AVX2__)
+    if constexpr (N % 32 == 0) {
+        __m256i sum = _mm256_setzero_si256();
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (int i = 0; i < N; i += 32) {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+        const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        const __m128i quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0b01001110));
+        return _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0b10110001)));
+    }
+#endif
+#if defined(__SSSE3__)
+    if constexpr (N % 16 == 0) {
+        __m128i sum = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        for (int i = 0; i < N; i += 16) {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+        }
+        const __m128i half = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+        return _mm_cvtsi128_si32(_mm_add_epi32(half, _mm_shuffle_epi32(half, 0b10110001)));
+    }
+#endif
+    int32_t sum = 0;
+    for (int i = 0; i < N; ++i) sum += input[i] * weights[i];
+    return sum;
+}
+
+#if defined(__SSSE3__)
+// four dot products against the same input, so each chunk of it is loaded once; the sums come
+// back in one vector, in row order
+template <int IN>
+static __m128i dot4(const uint8_t* input, const int8_t* const rows[4]) {
+    static_assert(IN % 32 == 0);
+#if defined(__AVX2__)
+    // adds up each 128-bit lane of four vectors and returns the four totals
+    auto fold = [](const __m256i a, const __m256i b, const __m256i c, const __m256i d) {
+        const __m256i sums = _mm256_hadd_epi32(_mm256_hadd_epi32(a, b), _mm256_hadd_epi32(c, d));
+        return _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    };
+#if defined(__AVX512BW__)
+    if constexpr (IN % 64 == 0) {
+        const __m512i ones = _mm512_set1_epi16(1);
+        __m512i sums[4] = {};
+        for (int i = 0; i < IN; i += 64) {
+            const __m512i in = _mm512_loadu_si512(input + i);
+            for (int r = 0; r < 4; ++r) {
+                const __m512i w = _mm512_loadu_si512(rows[r] + i);
+                sums[r] = _mm512_add_epi32(sums[r], _mm512_madd_epi16(_mm512_maddubs_epi16(in, w), ones));
+            }
+        }
+        auto half = [](const __m512i v) {
+            return _mm256_add_epi32(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+        };
+        return fold(half(sums[0]), half(sums[1]), half(sums[2]), half(sums[3]));
+    }
+#endif
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sums[4] = {};
+    for (int i = 0; i < IN; i += 32) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        for (int r = 0; r < 4; ++r) {
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i));
+            sums[r] = _mm256_add_epi32(sums[r], _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+    }
+    return fold(sums[0], sums[1], sums[2], sums[3]);
+#else
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sums[4] = {};
+    for (int i = 0; i < IN; i += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        for (int r = 0; r < 4; ++r) {
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i));
+            sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+        }
+    }
+    return _mm_hadd_epi32(_mm_hadd_epi32(sums[0], sums[1]), _mm_hadd_epi32(sums[2], sums[3]));
+#endif
+}
+#endif
+
+// a hidden layer: weights times input plus biases, shifted down and clipped to bytes again
+template <int IN, int OUT>
+static void hidden_layer(const uint8_t* input, const int8_t (*weights)[IN], const int32_t* biases, uint8_t* output) {
+#if defined(__SSSE3__)
+    static_assert(OUT % 4 == 0);
+    for (int o = 0; o < OUT; o += 4) {
+        const int8_t* const rows[4] = {weights[o], weights[o + 1], weights[o + 2], weights[o + 3]};
+        __m128i sums = _mm_add_epi32(dot4<IN>(input, rows), _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + o)));
+        sums = _mm_srai_epi32(sums, NNUE::WEIGHT_SCALE_BITS);
+        // the saturating packs clamp below at 0, the min above at ACTIVATION_MAX
+        const __m128i words = _mm_packs_epi32(sums, sums);
+        const __m128i bytes = _mm_min_epu8(_mm_packus_epi16(words, words), _mm_set1_epi8(NNUE::ACTIVATION_MAX));
+        const int32_t packed = _mm_cvtsi128_si32(bytes);
+        std::memcpy(output + o, &packed, sizeof(packed));
+    }
+#else
+    for (int o = 0; o < OUT; ++o) {
+        const int32_t sum = biases[o] + dot<IN>(input, weights[o]);
+        output[o] = static_cast<uint8_t>(std::clamp(sum >> NNUE::WEIGHT_SCALE_BITS, 0, NNUE::ACTIVATION_MAX));
+    }
+#endif
+}
+
+int NNUE::evaluate(const Accumulator& accumulator, const Turn side) {
+    alignas(64) uint8_t input[2 * L1];
+    alignas(64) uint8_t hidden1[L2];
+    alignas(64) uint8_t hidden2[L3];
+
+    clipped_relu(accumulator.values[side], input);
+    clipped_relu(accumulator.values[!side], input + L1);
+    hidden_layer<2 * L1, L2>(input, network->l1_weights, network->l1_biases, hidden1);
+    hidden_layer<L2, L3>(hidden1, network->l2_weights, network->l2_biases, hidden2);
+    const int32_t output = network->out_bias[0] + dot<L3>(hidden2, network->out_weights[0]);
+    return output / OUTPUT_SCALE;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "piece.hpp"
+#include "turn.hpp"
+
+struct NNUE {
+/**
+ * @brief An efficiently updatable neural network evaluation with HalfKP inputs.
+ *
+ * Each side sees the board from its own king: the inputs are the (king square, piece, square)
+ * triples of every piece but the kings, 64 * 641 of them. The first layer turns those into L1
+ * values per side. A move only changes a few inputs, so the board keeps these accumulators per
+ * ply and updates them by adding and subtracting weight rows. The layers after it
+ * (2 * L1 -> L2 -> L3 -> 1) take clipped int8 activations and run with SIMD where available.
+ *
+ * Without a network loaded the search falls back to the piece-square evaluation.
+ */
+    static constexpr int PIECE_INPUTS = 10 * 64 + 1;
+    static constexpr int INPUTS = 64 * PIECE_INPUTS;
+    static constexpr int L1 = 256;
+    static constexpr int L2 = 32;
+    static constexpr int L3 = 32;
+
+    // hidden layer sums are shifted down by this many bits, the output is divided by OUTPUT_SCALE
+    static constexpr int WEIGHT_SCALE_BITS = 6;
+    static constexpr int OUTPUT_SCALE = 16;
+    static constexpr int ACTIVATION_MAX = 127;
+
+    // network files start with this, then a version and the layer sizes as 32-bit integers
+    static constexpr char MAGIC[8] = {'C', 'H', 'L', 'I', 'N', 'N', 'U', 'E'};
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @brief The first layer's output for both sides, valid per side once computed.
+     */
+    struct alignas(64) Accumulator {
+        int16_t values[2][L1];
+        bool computed[2];
+    };
+
+    /**
+     * @brief The pieces a move took off or put on the board, enough to update an accumulator.
+     */
+    struct DirtyPieces {
+        static constexpr int MAX = 8;
+        Piece pieces[MAX];
+        uint8_t squares[MAX];
+        bool added[MAX];
+        uint8_t count;
+        // the accumulator has to be rebuilt from the board, the changes are not enough
+        bool refresh;
+
+        void record(const Piece piece, const uint8_t sq, const bool put) {
+            if (count == MAX) {
+                refresh = true;
+                return;
+            }
+            pieces[count] = piece;
+            squares[count] = sq;
+            added[count] = put;
+            count++;
+        }
+
+        // every input of a side depends on its king, so a king move means a refresh for that side
+        bool moves_king(const Turn side) const {
+            for (int i = 0; i < count; ++i) {
+                if (pieces[i].get_piece() == Piece::KING && pieces[i].get_color() == side) return true;
+            }
+            return false;
+        }
+    };
+
+    /**
+     * @brief The accumulator of one ply and the changes made by the move into it.
+     */
+    struct Frame {
+        Accumulator accumulator;
+        DirtyPieces dirty;
+
+        void reset() {
+            accumulator.computed[Turn::WHITE] = accumulator.computed[Turn::BLACK] = false;
+            dirty.count = 0;
+            dirty.refresh = false;
+        }
+        void invalidate() {
+            reset();
+            dirty.refresh = true;
+        }
+    };
+
+    /**
+     * @brief Returns if a network is loaded.
+     */
+    static bool is_loaded() { return network != nullptr; }
+
+    /**
+     * @brief Loads a network file, replacing the current network.
+     *
+     * The file holds the header, then little-endian arrays in this order: first layer biases
+     * (int16[L1]) and weights (int16[INPUTS][L1]), then for each of the three later layers its
+     * biases (int32[out]) and weights (int8[out][in]).
+     *
+     * @param path The file to read.
+     * @throws std::runtime_error if the file can't be read or doesn't match these layer sizes.
+     */
+    static void load(const std::string& path);
+
+    /**
+     * @brief Drops the network, the search goes back to the piece-square evaluation.
+     */
+    static void unload();
+
+    /**
+     * @brief Fills a network with random weights, for timing inference without a trained one.
+     *
+     * @param seed The seed of the weights, the same seed gives the same network.
+     */
+    static void init_random(uint32_t seed);
+
+    /**
+     * @brief Returns the input index of a piece on a square, as seen by one side.
+     *
+     * Black sees the board flipped vertically so both sides share the weights.
+     *
+     * @param perspective The side whose accumulator the input feeds.
+     * @param king_sq The square of that side's king.
+     * @param piece The piece, any but a king.
+     * @param sq The square of the piece.
+     */
+    static constexpr int feature_index(const Turn perspective, const int king_sq, const Piece piece, const int sq) {
+        const int flip = perspective == Turn::WHITE ? 0 : 56;
+        const int piece_index = piece.get_piece() * 2 + (piece.get_color() != perspective);
+        return (king_sq ^ flip) * PIECE_INPUTS + 1 + piece_index * 64 + (sq ^ flip);
+    }
+
+    /**
+     * @brief Sets one side of an accumulator to the first layer biases.
+     */
+    static void init_accumulator(int16_t* values);
+
+    /**
+     * @brief Adds an input's weights to one side of an accumulator.
+     */
+    static void add_feature(int16_t* values, int index);
+
+    /**
+     * @brief Subtracts an input's weights from one side of an accumulator.
+     */
+    static void remove_feature(int16_t* values, int index);
+
+    /**
+     * @brief Runs the layers after the accumulator.
+     *
+     * @param accumulator An accumulator computed for both sides.
+     * @param side The side to move, whose half goes first.
+     * @return The score from the side to move's view, in centipawns.
+     */
+    static int evaluate(const Accumulator& accumulator, Turn side);
+
+private:
+    struct Network;
+    static std::unique_ptr<Network> network;
+};
@@ -0,0 +1,95 @@
+/**
+ * Position file converter for ChessLi.
+ * Packs text positions (FEN lines) into fixed-size records that load without parsing, and writes
+ * them back out as text. No SFML.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "board.hpp"
+#include "position_file.hpp"
+
+static void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <COMMAND> <INPUT> <OUTPUT>\n";
+    std::cout << "  to-bin <TEXT> <FILE>  - Pack FEN lines into a position file. A line may go on with\n";
+    std::cout << "                          the result, \"cp <score>\" and \"bm <move>\"\n";
+    std::cout << "  to-fen <FILE> <TEXT>  - Write a position file back out as FEN lines\n";
+}
+
+static double seconds_since(const std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void print_result(const size_t count, const size_t skipped, const double seconds) {
+    std::cout << count << " positions (" << skipped << " skipped) in " << std::fixed << std::setprecision(3)
+              << seconds << "s (" << static_cast<uint64_t>(count / std::max(seconds, 1e-9)) << " per second)"
+              << std::endl;
+}
+
+static int to_bin(const std::string& input, const std::string& output) {
+    std::ifstream file(input);
+    if (!file) {
+        std::cerr << "Could not open " << input << std::endl;
+        return 2;
+    }
+    PositionWriter writer(output);
+    Board board;
+    PositionText text;
+    size_t skipped = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::string line; std::getline(file, line);) {
+        if (line.empty() || line[0] == '#') continue;
+        try {
+            if (!PositionText::parse(line, text)) throw std::runtime_error("Not a position");
+            writer.write(text.to_record(board));
+        } catch (const std::runtime_error&) {
+            skipped++;
+        }
+    }
+    writer.close();
+    print_result(writer.get_count(), skipped, seconds_since(start));
+    return 0;
+}
+
+static int to_fen(const std::string& input, const std::string& output) {
+    const PositionReader reader(input);
+    std::ofstream file(output);
+    if (!file) {
+        std::cerr << "Could not open " << output << std::endl;
+        return 2;
+    }
+    Board board;
+    size_t skipped = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const PackedPosition& record : reader) {
+        try {
+            file << PositionText::from_record(record, board) << '\n';
+        } catch (const std::runtime_error&) {
+            skipped++;
+        }
+    }
+    print_result(reader.size() - skipped, skipped, seconds_since(start));
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    const std::string command = argv[1];
+    try {
+        if (command == "to-bin") return to_bin(argv[2], argv[3]);
+        if (command == "to-fen") return to_fen(argv[2], argv[3]);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    print_usage(argv[0]);
+    return 2;
+}
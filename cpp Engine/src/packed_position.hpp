@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief A position in a fixed 40 bytes, for datasets that are read far more often than written.
+ *
+ * The pieces are stored as the occupied squares plus a nibble per piece in square order, at most
+ * 32 pieces. Records are plain data with no pointers, so a file of them can be mapped and read in
+ * place; Board::set_packed() loads one without going through a FEN string. Multi-byte fields are
+ * little-endian, as written on the platforms the engine builds for.
+ */
+struct PackedPosition {
+    static constexpr uint8_t NO_SQUARE = 64;
+    static constexpr int16_t NO_SCORE = INT16_MIN;
+    static constexpr uint8_t NO_RESULT = 0xFF;
+
+    uint64_t occupied;
+    // color << 3 | piece type per occupied square from a1 up, two to a byte, low nibble first
+    uint8_t pieces[16];
+    // Turn of the side to move
+    uint8_t turn;
+    // CastlingRights bits
+    uint8_t castling_rights;
+    // the en passant target square, or NO_SQUARE
+    uint8_t en_passant;
+    // saturates at 255, far past the fifty-move rule
+    uint8_t halfmove_clock;
+    uint16_t fullmove_clock;
+
+    // optional annotations, NO_SCORE, an empty move and NO_RESULT when unknown
+    // centipawns from the side to move's view
+    int16_t score;
+    // the raw Move
+    uint16_t best_move;
+    // the game result for white in half points: 0, 1 or 2
+    uint8_t result;
+    uint8_t reserved[5];
+
+    /**
+     * @brief Returns the nibble of the index-th occupied square, counted from a1 up.
+     */
+    constexpr uint8_t piece_at(const int index) const { return nibble_at(pieces, index); }
+
+    /**
+     * @brief Reads the index-th nibble of pieces laid out as in a record, for copies of the
+     * array like the tuner's.
+     */
+    static constexpr uint8_t nibble_at(const uint8_t* pieces, const int index) {
+        return (pieces[index / 2] >> (index % 2 * 4)) & 0xF;
+    }
+
+    // what a nibble holds: the color bit and the Piece::PieceType
+    static constexpr bool is_black(const uint8_t nibble) { return nibble >> 3; }
+    static constexpr int piece_type(const uint8_t nibble) { return nibble & 7; }
+};
+static_assert(sizeof(PackedPosition) == 40);
+static_assert(std::is_trivially_copyable_v<PackedPosition>);
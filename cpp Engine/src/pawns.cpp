@@ -0,0 +1,134 @@
+#include "pawns.hpp"
+
+#include <algorithm>
+
+#include "attacks.hpp"
+
+PawnTable::PawnTable() : entries(std::make_unique<PawnEntry[]>(SIZE)) {}
+
+void PawnTable::clear() {
+    for (size_t i = 0; i < SIZE; ++i) entries[i] = PawnEntry{};
+    reset_stats();
+}
+
+void PawnTable::reset_stats() {
+    probes.store(0, std::memory_order_relaxed);
+    hits.store(0, std::memory_order_relaxed);
+}
+
+void PawnTable::init() {
+    for (int file = 0; file < 8; ++file) {
+        const uint64_t file_mask = 0x0101010101010101ULL << file;
+        adjacent_files[file] = (file > 0 ? file_mask >> 1 : 0) | (file < 7 ? file_mask << 1 : 0);
+    }
+    for (int sq = 0; sq < 64; ++sq) {
+        const int rank = sq / 8;
+        const uint64_t file_mask = 0x0101010101010101ULL << (sq % 8);
+        // ranks strictly above and below this one
+        const uint64_t above = rank < 7 ? ~0ULL << (8 * (rank + 1)) : 0;
+        const uint64_t below = rank > 0 ? ~0ULL >> (8 * (8 - rank)) : 0;
+        const uint64_t level = 0xFFULL << (8 * rank);
+        const uint64_t adjacent = adjacent_files[sq % 8];
+
+        forward_file[Turn::WHITE][sq] = file_mask & above;
+        forward_file[Turn::BLACK][sq] = file_mask & below;
+        passed_span[Turn::WHITE][sq] = (file_mask | adjacent) & above;
+        passed_span[Turn::BLACK][sq] = (file_mask | adjacent) & below;
+        support_span[Turn::WHITE][sq] = adjacent & (below | level);
+        support_span[Turn::BLACK][sq] = adjacent & (above | level);
+    }
+}
+
+PawnEntry& PawnTable::probe(const Board& board) {
+    const uint64_t key = board.pawn_hash();
+    PawnEntry& entry = entries[key & (SIZE - 1)];
+    probes.store(probes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (entry.key == key) {
+        hits.store(hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return entry;
+    }
+
+    entry = PawnEntry{};
+    entry.key = key;
+    evaluate_pawns(board, entry);
+    return entry;
+}
+
+PSQT::Score PawnTable::evaluate(const Board& board) {
+    PawnEntry& entry = probe(board);
+    PSQT::Score score = entry.score;
+
+    int sq;
+    for (int color = 0; color < 2; ++color) {
+        const Turn side = static_cast<Turn>(color);
+        const int sign = side == Turn::WHITE ? 1 : -1;
+
+        // the shelter only changes with the king square, so it is reused until the king moves
+        const int king_sq = __builtin_ctzll(board.get_pieces(side, Piece::KING));
+        if (entry.shelter_king_sq[side] != king_sq) {
+            entry.shelter[side] = evaluate_shelter(board, side, king_sq);
+            entry.shelter_king_sq[side] = king_sq;
+        }
+        score += sign * entry.shelter[side];
+
+        // whether a passed pawn can advance depends on the other pieces, which the entry doesn't see
+        CTZLL_ITERATOR(sq, entry.passed[side]) {
+            if (forward_file[side][sq] & board.get_occupied()) continue;
+            const int relative_rank = side == Turn::WHITE ? sq / 8 : 7 - sq / 8;
+            score += sign * FREE_PASSED[relative_rank];
+        }
+    }
+    return board.get_turn() == Turn::WHITE ? score : -score;
+}
+
+void PawnTable::evaluate_pawns(const Board& board, PawnEntry& entry) {
+    int sq;
+    for (int color = 0; color < 2; ++color) {
+        const Turn side = static_cast<Turn>(color);
+        const Turn enemy = static_cast<Turn>(!side);
+        const Bitboard own_pawns = board.get_pieces(side, Piece::PAWN);
+        const Bitboard enemy_pawns = board.get_pieces(enemy, Piece::PAWN);
+        PSQT::Score score = 0;
+
+        CTZLL_ITERATOR(sq, own_pawns) {
+            const int relative_rank = side == Turn::WHITE ? sq / 8 : 7 - sq / 8;
+            const bool doubled = forward_file[side][sq] & own_pawns;
+            const bool isolated = !(adjacent_files[sq % 8] & own_pawns);
+
+            if (doubled) score += DOUBLED;
+            if (isolated) {
+                score += ISOLATED;
+            } else if (!(support_span[side][sq] & own_pawns)) {
+                // no pawn can come up to defend it and an enemy pawn guards the square in front
+                const int stop = side == Turn::WHITE ? sq + 8 : sq - 8;
+                if (AttackBitboards::pawn_attacks[side][stop] & enemy_pawns) score += BACKWARD;
+            }
+
+            // the rear one of two doubled pawns isn't counted, the front one runs first
+            if (!doubled && !(passed_span[side][sq] & enemy_pawns)) {
+                score += PASSED[relative_rank];
+                entry.passed[side].add_square(sq);
+            }
+        }
+        entry.score += side == Turn::WHITE ? score : -score;
+    }
+}
+
+PSQT::Score PawnTable::evaluate_shelter(const Board& board, const Turn side, const int king_sq) {
+    const Bitboard own_pawns = board.get_pieces(side, Piece::PAWN);
+    const int king_file = king_sq % 8;
+    const int king_rank = king_sq / 8;
+    const int forward = side == Turn::WHITE ? 1 : -1;
+    PSQT::Score score = 0;
+
+    for (int file = std::max(king_file - 1, 0); file <= std::min(king_file + 1, 7); ++file) {
+        PSQT::Score file_score = SHELTER_MISSING;
+        for (int distance = 2; distance >= 1; --distance) {
+            const int rank = king_rank + forward * distance;
+            if (rank < 0 || rank > 7) continue;
+            if (own_pawns.covers(rank * 8 + file)) file_score = SHELTER[distance - 1];
+        }
+        score += file_score;
+    }
+    return score;
+}
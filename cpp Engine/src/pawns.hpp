@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "bitboard.hpp"
+#include "board.hpp"
+#include "psqt.hpp"
+#include "turn.hpp"
+
+/**
+ * @brief The cached pawn structure evaluation of one set of pawns.
+ */
+struct PawnEntry {
+    // a king square no king stands on, marking a shelter as not computed yet
+    static constexpr uint8_t NO_KING = 64;
+
+    uint64_t key = 0;
+    // doubled, isolated, backward and passed pawn terms, white's minus black's
+    PSQT::Score score = 0;
+    // pawns with no enemy pawn in front of them on their own or the adjacent files
+    Bitboard passed[2];
+    // the shelter also depends on the king square, so it is kept for the last one seen per side
+    uint8_t shelter_king_sq[2] = {NO_KING, NO_KING};
+    PSQT::Score shelter[2] = {};
+};
+
+class PawnTable {
+/**
+ * @brief A small hash table of pawn structure evaluations, keyed by the board's pawn key.
+ *
+ * Pawns move rarely compared to the other pieces, so most positions a search visits share their
+ * pawns with one evaluated shortly before and are answered from the table. Each search thread
+ * owns one, so entries are read and written without any synchronization. The pawn terms only
+ * feed the piece-square evaluation; a network sees the pawns on its own.
+ */
+public:
+    // entries in the table, a power of two; the hit rate shows whether it is large enough
+    static constexpr size_t SIZE = 1 << 13;
+
+    // the weights from eval_weights.hpp, packed
+    static constexpr PSQT::Score DOUBLED = PSQT::make_score(EvalWeights::MG_DOUBLED_PAWN, EvalWeights::EG_DOUBLED_PAWN);
+    static constexpr PSQT::Score ISOLATED = PSQT::make_score(EvalWeights::MG_ISOLATED_PAWN, EvalWeights::EG_ISOLATED_PAWN);
+    static constexpr PSQT::Score BACKWARD = PSQT::make_score(EvalWeights::MG_BACKWARD_PAWN, EvalWeights::EG_BACKWARD_PAWN);
+    static constexpr auto PASSED = PSQT::make_scores(EvalWeights::MG_PASSED_PAWN, EvalWeights::EG_PASSED_PAWN);
+    static constexpr auto FREE_PASSED = PSQT::make_scores(EvalWeights::MG_FREE_PASSED_PAWN, EvalWeights::EG_FREE_PASSED_PAWN);
+    static constexpr auto SHELTER = PSQT::make_scores(EvalWeights::MG_PAWN_SHELTER, EvalWeights::EG_PAWN_SHELTER);
+    static constexpr PSQT::Score SHELTER_MISSING = PSQT::make_score(EvalWeights::MG_SHELTER_MISSING, EvalWeights::EG_SHELTER_MISSING);
+
+    PawnTable();
+
+    /**
+     * @brief Empties every entry and resets the hit counters.
+     */
+    void clear();
+
+    /**
+     * @brief Evaluates the pawns and the kings' pawn shelters, from the table when it can.
+     *
+     * @param board The position.
+     * @return The packed score from the side to move's view, not tapered yet.
+     */
+    PSQT::Score evaluate(const Board& board);
+
+    /**
+     * @brief Returns the entry of the board's pawns, evaluating them into it on a miss.
+     */
+    PawnEntry& probe(const Board& board);
+
+    /**
+     * @brief Returns how many probes there were and how many of them found their entry.
+     */
+    uint64_t get_probes() const { return probes.load(std::memory_order_relaxed); }
+    uint64_t get_hits() const { return hits.load(std::memory_order_relaxed); }
+    void reset_stats();
+
+    // squares in front of a pawn on its file, and on its own and the adjacent files
+    static inline Bitboard forward_file[2][64];
+    static inline Bitboard passed_span[2][64];
+    // squares on the adjacent files level with a pawn or behind it, where its defenders stand
+    static inline Bitboard support_span[2][64];
+    static inline Bitboard adjacent_files[8];
+
+    static void init();
+
+private:
+    static void evaluate_pawns(const Board& board, PawnEntry& entry);
+    static PSQT::Score evaluate_shelter(const Board& board, Turn side, int king_sq);
+
+    std::unique_ptr<PawnEntry[]> entries;
+    // only written by the owning thread, relaxed so others can read them
+    std::atomic<uint64_t> probes = 0;
+    std::atomic<uint64_t> hits = 0;
+};
+
+inline const auto _pawn_table_initializer = []() {
+    PawnTable::init();
+    return true;
+}();
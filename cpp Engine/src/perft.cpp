@@ -0,0 +1,91 @@
+#include "perft.hpp"
+#include <algorithm>
+#include <thread>
+
+Perft::Perft(const size_t hash_mb, const int threads) : threads(std::max(threads, 1)) {
+    entry_count = hash_mb * 1024 * 1024 / sizeof(Entry);
+    if (entry_count) {
+        entries = std::make_unique<Entry[]>(entry_count);
+        for (size_t i = 0; i < entry_count; ++i) {
+            entries[i].key_xor_data.store(0, std::memory_order_relaxed);
+            entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t Perft::run(const Board& board, const int depth) {
+    if (depth <= 0) return 1;
+
+    uint64_t total = 0;
+    for (const auto& [move, count] : divide(board, depth)) total += count;
+    return total;
+}
+
+std::vector<std::pair<Move, uint64_t>> Perft::divide(const Board& board, const int depth) {
+    Board root(board);
+    MoveList moves;
+    root.generate(moves);
+
+    std::vector<std::pair<Move, uint64_t>> results;
+    for (const Move& move : moves) results.emplace_back(move, 0);
+
+    // workers take the next unclaimed root move until there are none left
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        Board local(board);
+        std::vector<BoardState> states(depth + 1);
+        for (size_t i = next++; i < results.size(); i = next++) {
+            make(local, results[i].first, states[depth]);
+            results[i].second = perft(local, depth - 1, states.data());
+            unmake(local, states[depth]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const int count = std::min<int>(threads, static_cast<int>(results.size()));
+    for (int i = 1; i < count; ++i) workers.emplace_back(worker);
+    worker();
+    for (auto& thread : workers) thread.join();
+    return results;
+}
+
+uint64_t Perft::perft(Board& board, const int depth, BoardState* states) {
+    if (depth == 0) return 1;
+    // the leaves are only counted, the last ply never needs its moves made or even stored
+    if (depth == 1) return board.count_moves();
+
+    uint64_t count;
+    if (probe(board.hash(), depth, count)) return count;
+
+    MoveList moves;
+    board.generate(moves);
+    count = 0;
+    for (const Move& move : moves) {
+        make(board, move, states[depth]);
+        count += perft(board, depth - 1, states);
+        unmake(board, states[depth]);
+    }
+
+    store(board.hash(), depth, count);
+    return count;
+}
+
+bool Perft::probe(const uint64_t key, const int depth, uint64_t& count) const {
+    if (!entry_count) return false;
+
+    const Entry& entry = entries[index(key)];
+    const uint64_t data = entry.data.load(std::memory_order_relaxed);
+    if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) != key) return false;
+    if (static_cast<int>(data & 0xFF) != depth) return false;
+    count = data >> 8;
+    return true;
+}
+
+void Perft::store(const uint64_t key, const int depth, const uint64_t count) {
+    if (!entry_count) return;
+
+    Entry& entry = entries[index(key)];
+    const uint64_t data = (count << 8) | static_cast<uint8_t>(depth);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "board.hpp"
+#include "move.hpp"
+
+class Perft {
+/**
+ * @brief Counts the leaf nodes of the legal move tree, for validating move generation.
+ *
+ * Root moves are split over worker threads, each walking its own copy of the board. An
+ * optional hash table caches subtree counts by Zobrist key and depth; it is shared by the
+ * workers and validated the same way as the transposition table, so no locks are taken.
+ */
+public:
+    /**
+     * @brief Constructs a new Perft object.
+     *
+     * @param hash_mb The size of the subtree count cache in megabytes, 0 to disable it.
+     * @param threads The number of threads to split the root moves over.
+     */
+    Perft(size_t hash_mb = 0, int threads = 1);
+
+    /**
+     * @brief Counts the leaf nodes at a depth.
+     *
+     * @param board The position to count from, unchanged on return.
+     * @param depth The depth in plies.
+     * @return The number of leaf nodes.
+     */
+    uint64_t run(const Board& board, int depth);
+
+    /**
+     * @brief Counts the leaf nodes at a depth under each root move.
+     *
+     * @param board The position to count from, unchanged on return.
+     * @param depth The depth in plies, at least 1.
+     * @return Each root move with its leaf count, in generation order.
+     */
+    std::vector<std::pair<Move, uint64_t>> divide(const Board& board, int depth);
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> key_xor_data;
+        std::atomic<uint64_t> data;
+    };
+
+    // data layout: count (56) | depth (8)
+    bool probe(const uint64_t key, const int depth, uint64_t& count) const;
+    void store(const uint64_t key, const int depth, const uint64_t count);
+    size_t index(const uint64_t key) const {
+        return static_cast<size_t>((static_cast<unsigned __int128>(key) * entry_count) >> 64);
+    }
+
+    // copy-make builds keep the state before each move in states[depth]
+    uint64_t perft(Board& board, int depth, BoardState* states);
+    static void make(Board& board, const Move& move, BoardState& saved) {
+        if constexpr (Board::COPY_MAKE) board.make_move(&move, saved);
+        else board.make_move(&move);
+    }
+    static void unmake(Board& board, const BoardState& saved) {
+        if constexpr (Board::COPY_MAKE) board.undo_move(saved);
+        else board.undo_move();
+    }
+
+    std::unique_ptr<Entry[]> entries;
+    size_t entry_count = 0;
+    int threads;
+};
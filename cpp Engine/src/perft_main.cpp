@@ -0,0 +1,187 @@
+/**
+ * Perft driver for ChessLi move generation.
+ * Runs an EPD suite of positions with known leaf counts, or a single position with divide.
+ * No SFML - exits nonzero if any count is wrong so it can gate builds.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "perft.hpp"
+
+// each line is a FEN followed by ";D<depth> <nodes>" entries
+static const char* STANDARD_SUITE[] = {
+    // the standard positions
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400 ;D3 8902 ;D4 197281 ;D5 4865609 ;D6 119060324",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 ;D1 48 ;D2 2039 ;D3 97862 ;D4 4085603 ;D5 193690690",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1 ;D1 14 ;D2 191 ;D3 2812 ;D4 43238 ;D5 674624 ;D6 11030083",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1 ;D1 6 ;D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1 ;D1 6 ;D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8 ;D1 44 ;D2 1486 ;D3 62379 ;D4 2103487 ;D5 89941194",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10 ;D1 46 ;D2 2079 ;D3 89890 ;D4 3894594 ;D5 164075551",
+
+    // en passant edge cases
+    "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1 ;D6 1134888",
+    "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1 ;D6 1015133",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1 ;D6 1440467",
+    "8/5bk1/8/2Pp4/8/1K6/8/8 w - d6 0 1 ;D6 824064",
+
+    // castling edge cases
+    "5k2/8/8/8/8/8/8/4K2R w K - 0 1 ;D6 661072",
+    "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1 ;D6 803711",
+    "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1 ;D4 1274206",
+    "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1 ;D4 1720476",
+    "1r2k2r/8/8/8/8/8/8/R3K2R w KQk - 0 1 ;D1 26 ;D2 583 ;D3 14252",
+
+    // promotion, check and stalemate edge cases
+    "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1 ;D6 3821001",
+    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1 ;D5 1004658",
+    "4k3/1P6/8/8/8/8/K7/8 w - - 0 1 ;D6 217342",
+    "8/P1k5/K7/8/8/8/8/8 w - - 0 1 ;D6 92683",
+    "K1k5/8/P7/8/8/8/8/8 w - - 0 1 ;D6 2217",
+    "8/k1P5/8/1K6/8/8/8/8 w - - 0 1 ;D7 567584",
+    "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1 ;D4 23527",
+};
+
+struct EpdEntry {
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> depths;
+};
+
+static bool parse_epd(const std::string& line, EpdEntry& entry) {
+    const size_t first = line.find(';');
+    entry.fen = line.substr(0, first);
+    entry.fen.erase(entry.fen.find_last_not_of(' ') + 1);
+    entry.depths.clear();
+    if (entry.fen.empty() || first == std::string::npos) return false;
+
+    std::istringstream iss(line.substr(first));
+    std::string field;
+    while (std::getline(iss, field, ';')) {
+        std::istringstream fields(field);
+        std::string depth;
+        uint64_t nodes;
+        if (fields >> depth >> nodes && depth.size() > 1 && depth[0] == 'D') {
+            entry.depths.emplace_back(std::stoi(depth.substr(1)), nodes);
+        }
+    }
+    return !entry.depths.empty();
+}
+
+static void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n";
+    std::cout << "  --suite <FILE>   - Run an EPD suite instead of the built-in one\n";
+    std::cout << "  --fen <FEN>      - Count a single position instead of a suite\n";
+    std::cout << "  --depth <N>      - Depth for --fen, or the deepest entry to run from a suite\n";
+    std::cout << "  --divide         - With --fen, print the count under each root move\n";
+    std::cout << "  --hash <MB>      - Cache subtree counts in a table of this size (default: off)\n";
+    std::cout << "  --threads <N>    - Split the root moves over N threads (default: 1)\n";
+}
+
+static double seconds_since(const std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void print_result(const uint64_t nodes, const double seconds) {
+    std::cout << nodes << " nodes in " << std::fixed << std::setprecision(3) << seconds << "s ("
+              << static_cast<uint64_t>(nodes / std::max(seconds, 1e-9)) << " nps)";
+}
+
+int main(int argc, char* argv[]) {
+    std::string suite_file, fen;
+    int depth = 0;
+    bool divide = false;
+    size_t hash_mb = 0;
+    int threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--suite" && i + 1 < argc) suite_file = argv[++i];
+        else if (arg == "--fen" && i + 1 < argc) fen = argv[++i];
+        else if (arg == "--depth" && i + 1 < argc) depth = std::stoi(argv[++i]);
+        else if (arg == "--divide") divide = true;
+        else if (arg == "--hash" && i + 1 < argc) hash_mb = std::stoul(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Perft perft(hash_mb, threads);
+
+    // single position
+    if (!fen.empty()) {
+        Board board(fen);
+        depth = std::max(depth, 1);
+        const auto start = std::chrono::steady_clock::now();
+        uint64_t total = 0;
+        if (divide) {
+            for (const auto& [move, count] : perft.divide(board, depth)) {
+                std::cout << move.to_uci() << ": " << count << "\n";
+                total += count;
+            }
+        } else {
+            total = perft.run(board, depth);
+        }
+        std::cout << "depth " << depth << ": ";
+        print_result(total, seconds_since(start));
+        std::cout << std::endl;
+        return 0;
+    }
+
+    // suite
+    std::vector<std::string> lines;
+    if (!suite_file.empty()) {
+        std::ifstream file(suite_file);
+        if (!file) {
+            std::cerr << "Could not open " << suite_file << std::endl;
+            return 2;
+        }
+        for (std::string line; std::getline(file, line);) lines.push_back(line);
+    } else {
+        lines.assign(std::begin(STANDARD_SUITE), std::end(STANDARD_SUITE));
+    }
+
+    int failures = 0;
+    int run = 0;
+    uint64_t total_nodes = 0;
+    const auto suite_start = std::chrono::steady_clock::now();
+    EpdEntry entry;
+    for (const std::string& line : lines) {
+        if (!parse_epd(line, entry)) continue;
+
+        // the deepest entry within the depth limit
+        const std::pair<int, uint64_t>* target = nullptr;
+        for (const auto& d : entry.depths) {
+            if ((depth == 0 || d.first <= depth) && (!target || d.first > target->first)) target = &d;
+        }
+        if (!target) continue;
+
+        Board board(entry.fen);
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t nodes = perft.run(board, target->first);
+        const double seconds = seconds_since(start);
+        const bool ok = nodes == target->second;
+        run++;
+        total_nodes += nodes;
+        if (!ok) failures++;
+
+        std::cout << (ok ? "ok   " : "FAIL ") << entry.fen << " depth " << target->first << ": ";
+        print_result(nodes, seconds);
+        if (!ok) std::cout << " expected " << target->second;
+        std::cout << std::endl;
+    }
+
+    std::cout << run - failures << "/" << run << " passed, ";
+    print_result(total_nodes, seconds_since(suite_start));
+    std::cout << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#include "position_file.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// set_fen trusts its input, so the piece placement is checked before it gets there
+static bool valid_placement(const std::string& placement) {
+    int ranks = 1, files = 0;
+    for (const char c : placement) {
+        if (c == '/') {
+            if (files != 8) return false;
+            ranks++;
+            files = 0;
+        } else if (c >= '1' && c <= '8') {
+            files += c - '0';
+        } else if (std::string("pnbrqkPNBRQK").find(c) != std::string::npos) {
+            files++;
+        } else {
+            return false;
+        }
+        if (files > 8) return false;
+    }
+    return ranks == 8 && files == 8;
+}
+
+// set_fen reads any two characters as the en passant square, so only a real target square for the side to move passes
+static bool valid_en_passant(const std::string& field, const std::string& turn) {
+    if (field == "-") return true;
+    return field.size() == 2 && field[0] >= 'a' && field[0] <= 'h' && field[1] == (turn == "w" ? '6' : '3');
+}
+
+// centipawns clamped to what a record holds, or NO_SCORE if the token isn't a number
+static int parse_score(const std::string& token) {
+    long long value;
+    const char* const end = token.data() + token.size();
+    const auto [ptr, error] = std::from_chars(token.data(), end, value);
+    if (ptr != end) return PackedPosition::NO_SCORE;
+    // out of range of long long is still far out of range of a score
+    if (error == std::errc::result_out_of_range) value = token[0] == '-' ? -INT16_MAX : INT16_MAX;
+    else if (error != std::errc()) return PackedPosition::NO_SCORE;
+    return static_cast<int>(std::clamp<long long>(value, -INT16_MAX, INT16_MAX));
+}
+
+static bool is_integer(const std::string& s) {
+    const size_t digits = !s.empty() && s[0] == '-' ? 1 : 0;
+    return s.size() > digits
+        && std::all_of(s.begin() + digits, s.end(), [](const unsigned char c) { return std::isdigit(c); });
+}
+
+// the result for white in half points, or NO_RESULT if the token isn't one
+static int parse_result(std::string token) {
+    token.erase(std::remove_if(token.begin(), token.end(),
+                               [](const char c) { return c == '[' || c == ']' || c == '"' || c == ';'; }),
+                token.end());
+    if (token == "1-0" || token == "1" || token == "1.0") return 2;
+    if (token == "1/2-1/2" || token == "0.5" || token == ".5") return 1;
+    if (token == "0-1" || token == "0" || token == "0.0") return 0;
+    return PackedPosition::NO_RESULT;
+}
+
+bool PositionText::parse(const std::string& line, PositionText& text) {
+    std::istringstream iss(line);
+    std::vector<std::string> fields;
+    std::string field;
+    while (iss >> field) fields.push_back(field);
+    if (fields.size() < 4 || !valid_placement(fields[0])) return false;
+    if ((fields[1] != "w" && fields[1] != "b") || !valid_en_passant(fields[3], fields[1])) return false;
+
+    size_t next = 4;
+    text.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+    if (fields.size() >= 6 && is_integer(fields[4]) && is_integer(fields[5]) && fields[4][0] != '-') {
+        text.fen += " " + fields[4] + " " + fields[5];
+        next = 6;
+    } else {
+        text.fen += " 0 1";
+    }
+
+    text.result = PackedPosition::NO_RESULT;
+    text.score = PackedPosition::NO_SCORE;
+    text.best_move.clear();
+    for (size_t i = next; i < fields.size(); ++i) {
+        if (fields[i] == "cp" && i + 1 < fields.size()) {
+            text.score = parse_score(fields[++i]);
+        } else if (fields[i] == "bm" && i + 1 < fields.size()) {
+            text.best_move = fields[++i];
+            text.best_move.erase(std::remove(text.best_move.begin(), text.best_move.end(), ';'), text.best_move.end());
+        } else if (text.result == PackedPosition::NO_RESULT) {
+            text.result = parse_result(fields[i]);
+        }
+    }
+    return true;
+}
+
+std::string PositionText::from_record(const PackedPosition& record, Board& board) {
+    board.set_packed(record);
+    std::string line = board.get_fen();
+    if (record.result <= 2) {
+        line += record.result == 2 ? " [1.0]" : record.result == 1 ? " [0.5]" : " [0.0]";
+    }
+    if (record.score != PackedPosition::NO_SCORE) line += " cp " + std::to_string(record.score);
+    if (record.best_move) line += " bm " + Move(record.best_move).to_uci();
+    return line;
+}
+
+PackedPosition PositionText::to_record(Board& board) const {
+    board.set_fen(fen);
+    // nothing can be played or searched without both kings
+    if (!board.get_pieces(Turn::WHITE, Piece::KING) || !board.get_pieces(Turn::BLACK, Piece::KING)) {
+        throw std::runtime_error("Position is missing a king: " + fen);
+    }
+    PackedPosition record = board.pack();
+    record.result = static_cast<uint8_t>(result);
+    record.score = static_cast<int16_t>(score);
+
+    if (!best_move.empty()) {
+        const auto move = Move::from_uci(best_move);
+        if (!move) throw std::runtime_error("Not a move: " + best_move);
+        for (const Move& legal : board.get_moves()) {
+            if (legal.start() == move->start() && legal.end() == move->end()
+                && (legal.flag() == move->flag() || (!legal.is_promotion() && !move->is_promotion()))) {
+                record.best_move = legal.move;
+                break;
+            }
+        }
+        if (!record.best_move) throw std::runtime_error("Best move is not legal: " + best_move);
+    }
+    return record;
+}
+
+PositionWriter::PositionWriter(const std::string& path) : file(path, std::ios::binary), path(path) {
+    if (!file) throw std::runtime_error("Cannot create position file: " + path);
+    const uint32_t header[2] = {VERSION, sizeof(PackedPosition)};
+    file.write(MAGIC, sizeof(MAGIC));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void PositionWriter::write(const PackedPosition& record) {
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    count++;
+}
+
+void PositionWriter::close() {
+    file.close();
+    if (!file) throw std::runtime_error("Failed writing position file: " + path);
+}
+
+bool PositionReader::is_position_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(PositionWriter::MAGIC)];
+    return file.read(magic, sizeof(magic)) && std::equal(magic, magic + sizeof(magic), PositionWriter::MAGIC);
+}
+
+PositionReader::PositionReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open position file: " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < PositionWriter::HEADER_SIZE) {
+        ::close(fd);
+        throw std::runtime_error("Not a position file: " + path);
+    }
+    mapped_size = static_cast<size_t>(info.st_size);
+    mapping = ::mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file open on its own
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Cannot map position file: " + path);
+    }
+    ::madvise(mapping, mapped_size, MADV_SEQUENTIAL);
+
+    const char* data = static_cast<const char*>(mapping);
+    uint32_t header[2];
+    std::memcpy(header, data + sizeof(PositionWriter::MAGIC), sizeof(header));
+    const size_t records_size = mapped_size - PositionWriter::HEADER_SIZE;
+    std::string error;
+    if (!std::equal(data, data + sizeof(PositionWriter::MAGIC), PositionWriter::MAGIC)) {
+        error = "Not a position file: ";
+    } else if (header[0] != PositionWriter::VERSION || header[1] != sizeof(PackedPosition)) {
+        error = "Position file has a different version or record size: ";
+    } else if (records_size % sizeof(PackedPosition) != 0) {
+        error = "Position file is truncated: ";
+    }
+    if (!error.empty()) {
+        ::munmap(mapping, mapped_size);
+        mapping = nullptr;
+        throw std::runtime_error(error + path);
+    }
+
+    records = reinterpret_cast<const PackedPosition*>(data + PositionWriter::HEADER_SIZE);
+    count = records_size / sizeof(PackedPosition);
+}
+
+PositionReader::~PositionReader() {
+    if (mapping) ::munmap(mapping, mapped_size);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "packed_position.hpp"
+
+/**
+ * @brief A position as a line of text: a FEN and optionally the game result, a score and a best move.
+ *
+ * The result is 1-0, 0-1 or 1/2-1/2, or 1.0, 0.5 or 0.0 for white, and may be wrapped in brackets
+ * or quotes as in "[0.5]" or c9 "1-0";. A score is written "cp <centipawns>" from the side to
+ * move's view, a best move "bm <uci move>". The FEN may leave out its clocks.
+ */
+struct PositionText {
+    std::string fen;
+    int result = PackedPosition::NO_RESULT;
+    int score = PackedPosition::NO_SCORE;
+    std::string best_move;
+
+    /**
+     * @brief Parses a line, checking the FEN enough that Board::set_fen() can take it.
+     *
+     * The en passant square has to be on the rank the side to move captures onto. A score that
+     * isn't a number is left as NO_SCORE, one past the range of a record is clamped to it.
+     *
+     * @return false if the line doesn't start with a FEN.
+     */
+    static bool parse(const std::string& line, PositionText& text);
+
+    /**
+     * @brief Converts a record to a line of text.
+     *
+     * @param board Scratch board the record is loaded into.
+     * @throws std::runtime_error if the record is invalid.
+     */
+    static std::string from_record(const PackedPosition& record, Board& board);
+
+    /**
+     * @brief Converts the line to a record.
+     *
+     * @param board Scratch board the FEN is loaded into.
+     * @throws std::runtime_error if the FEN doesn't load, lacks a king or the best move isn't legal in it.
+     */
+    PackedPosition to_record(Board& board) const;
+};
+
+class PositionWriter {
+/**
+ * @brief Writes packed positions to a file, after a small header.
+ *
+ * The header is the magic "CHLIPOS\0", then the format version and the record size as 32-bit
+ * integers. Records follow back to back, so the file can be appended to and its length gives
+ * the count.
+ */
+public:
+    static constexpr char MAGIC[8] = {'C', 'H', 'L', 'I', 'P', 'O', 'S', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+
+    /**
+     * @brief Creates the file and writes its header, replacing any file there.
+     *
+     * @throws std::runtime_error if the file can't be created.
+     */
+    explicit PositionWriter(const std::string& path);
+
+    void write(const PackedPosition& record);
+
+    /**
+     * @brief Flushes the file.
+     *
+     * @throws std::runtime_error if anything failed to write.
+     */
+    void close();
+
+    size_t get_count() const { return count; }
+
+private:
+    std::ofstream file;
+    std::string path;
+    size_t count = 0;
+};
+
+class PositionReader {
+/**
+ * @brief Maps a file of packed positions into memory and reads the records in place.
+ *
+ * Nothing is copied or parsed up front; pages are loaded by the OS as records are touched, so
+ * opening is instant and a dataset larger than memory still works.
+ */
+public:
+    /**
+     * @brief Opens and maps a file written by PositionWriter.
+     *
+     * @throws std::runtime_error if the file can't be mapped or has a different header.
+     */
+    explicit PositionReader(const std::string& path);
+    ~PositionReader();
+    PositionReader(const PositionReader&) = delete;
+    PositionReader& operator=(const PositionReader&) = delete;
+
+    /**
+     * @brief Returns if a file starts with the header PositionWriter writes.
+     */
+    static bool is_position_file(const std::string& path);
+
+    size_t size() const { return count; }
+    const PackedPosition& operator[](const size_t index) const { return records[index]; }
+    const PackedPosition* begin() const { return records; }
+    const PackedPosition* end() const { return records + count; }
+
+private:
+    void* mapping = nullptr;
+    size_t mapped_size = 0;
+    const PackedPosition* records = nullptr;
+    size_t count = 0;
+};
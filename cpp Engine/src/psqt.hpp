@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "eval_weights.hpp"
+#include "piece.hpp"
+#include "turn.hpp"
+
+struct PSQT {
+/**
+ * @brief Material values and piece-square tables of the static evaluation, one set for the
+ * middlegame and one for the endgame, as weighted in eval_weights.hpp.
+ *
+ * Tables are laid out from white's side with A1 first; black reads them mirrored through
+ * the centre of the board. The board sums both sets at once as packed Scores and blends them
+ * by the game phase when evaluating.
+ */
+
+    /**
+     * @brief A middlegame and an endgame value in one 32-bit integer, so adding or subtracting
+     * two Scores updates both halves in a single instruction.
+     *
+     * The endgame value sits in the upper 16 bits. The middlegame value is the sign-extended
+     * lower 16 bits; when it is negative it borrows one from the upper half, which eg_value()
+     * rounds back out. Each half must stay within int16 range.
+     */
+    using Score = int32_t;
+
+    static constexpr Score make_score(const int mg, const int eg) {
+        return static_cast<Score>(static_cast<uint32_t>(eg) << 16) + mg;
+    }
+    // packs a table of middlegame values and one of endgame values together
+    template <size_t N>
+    static constexpr std::array<Score, N> make_scores(const int (&mg)[N], const int (&eg)[N]) {
+        std::array<Score, N> scores{};
+        for (size_t i = 0; i < N; ++i) scores[i] = make_score(mg[i], eg[i]);
+        return scores;
+    }
+    static constexpr int mg_value(const Score score) {
+        return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(score)));
+    }
+    static constexpr int eg_value(const Score score) {
+        return static_cast<int16_t>(static_cast<uint16_t>((static_cast<uint32_t>(score) + 0x8000) >> 16));
+    }
+
+    // how much each piece counts towards the middlegame; all of them on the board make MAX_PHASE
+    static constexpr int PHASE_WEIGHTS[6] = {0, 1, 1, 2, 4, 0};
+    static constexpr int MAX_PHASE = 24;
+
+    /**
+     * @brief Blends the two halves of a Score by the game phase.
+     *
+     * @param score The packed score.
+     * @param phase The phase, MAX_PHASE for the opening down to 0 for bare kings and pawns.
+     * Promotions can push it past MAX_PHASE, which counts as MAX_PHASE.
+     */
+    static constexpr int taper(const Score score, int phase) {
+        if (phase > MAX_PHASE) phase = MAX_PHASE;
+        return (mg_value(score) * phase + eg_value(score) * (MAX_PHASE - phase)) / MAX_PHASE;
+    }
+
+    // the weights live in eval_weights.hpp, which chessli-tune regenerates; the middlegame piece
+    // values are also what move ordering and delta pruning go by
+    static constexpr const auto& MG_PIECE_VALUES = EvalWeights::MG_PIECE_VALUES;
+    static constexpr const auto& EG_PIECE_VALUES = EvalWeights::EG_PIECE_VALUES;
+    static constexpr const auto& MG_POSITION_VALUES = EvalWeights::MG_POSITION_VALUES;
+    static constexpr const auto& EG_POSITION_VALUES = EvalWeights::EG_POSITION_VALUES;
+
+    // material plus position for both phases, packed once so the board does a single add per piece
+    static inline Score packed[6][64];
+
+    static void init() {
+        for (int piece = 0; piece < 6; ++piece) {
+            for (int sq = 0; sq < 64; ++sq) {
+                packed[piece][sq] = make_score(MG_PIECE_VALUES[piece] + MG_POSITION_VALUES[piece][sq],
+                                               EG_PIECE_VALUES[piece] + EG_POSITION_VALUES[piece][sq]);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the material plus positional value of a piece on a square, for both phases.
+     *
+     * @param color The color of the piece.
+     * @param piece The type of the piece.
+     * @param sq The square (0-63).
+     */
+    static Score value(const Turn color, const Piece::PieceType piece, const int sq) {
+        return packed[piece][color == Turn::WHITE ? sq : 63 - sq];
+    }
+};
+
+inline const auto _psqt_initializer = []() {
+    PSQT::init();
+    return true;
+}();
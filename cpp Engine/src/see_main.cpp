@@ -0,0 +1,146 @@
+/**
+ * Static exchange evaluation checker for ChessLi.
+ * Runs an EPD suite of positions with the known SEE value of some of their moves, and checks
+ * see_ge against see around each value. No SFML - exits nonzero on any mismatch.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+// each line is a FEN followed by ";<uci move> <see>" entries, values as in Board::SEE_VALUES
+static const char* STANDARD_SUITE[] = {
+    // plain captures and exchanges
+    "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1 ;e1e5 100",
+    "4k3/8/8/3r4/8/8/8/3RK3 w - - 0 1 ;d1d5 500",
+    "4k3/8/4p3/3p4/8/8/8/3RK3 w - - 0 1 ;d1d5 -400",
+    "2k5/8/8/8/3p4/4P3/5K2/8 b - - 0 1 ;d4e3 0",
+    "4k3/8/2n5/4p3/8/3N4/8/4QK2 w - - 0 1 ;d3e5 100 ;e1e5 -500",
+
+    // quiet moves and castling
+    "4k3/8/8/4p3/8/8/8/3QK3 w - - 0 1 ;d1d4 -900",
+    "4k3/8/8/8/8/8/8/R3K3 w - - 0 1 ;a1a5 0",
+    "4k3/8/8/8/8/8/8/4K2R w K - 0 1 ;e1g1 0",
+
+    // x-rays through the capturing piece and behind the recapturers
+    "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1 ;d3e5 -200",
+    "4k3/8/2b5/3p4/4P3/5B2/8/4K3 w - - 0 1 ;e4d5 100",
+    "3rk3/8/8/3r4/8/8/3R4/3RK3 w - - 0 1 ;d2d5 500",
+    "4k3/8/8/3p4/4n3/8/6B1/K6Q w - - 0 1 ;g2e4 80",
+
+    // en passant, where the captured pawn isn't on the target square
+    "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1 ;e5d6 100",
+    "4k3/2b5/8/3pP3/8/8/8/4K3 w - d6 0 1 ;e5d6 0",
+    "8/4k3/8/3pP3/8/8/8/4K3 w - d6 0 1 ;e5d6 0",
+    "8/4k3/8/3pP3/8/8/8/3RK3 w - d6 0 1 ;e5d6 100",
+    "4k3/8/8/8/3Pp3/8/8/4K3 b - d3 0 1 ;e4d3 100",
+    "4k3/8/8/8/3Pp3/8/2K5/8 b - d3 0 1 ;e4d3 0",
+
+    // promotions, with and without a capture
+    "4k3/1P6/8/8/8/8/8/4K3 w - - 0 1 ;b7b8q 800 ;b7b8n 200",
+    "1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1 ;a7a8q -100 ;a7b8q 1300",
+    "1r2k3/P2n4/8/8/8/8/8/4K3 w - - 0 1 ;a7b8q 400 ;a7b8n 400",
+
+    // the king only recaptures when nothing can take it back
+    "4k3/4p3/8/8/8/8/8/4QK2 w - - 0 1 ;e1e7 -800",
+    "4k3/4p3/8/8/8/8/4Q3/4RK2 w - - 0 1 ;e2e7 100",
+    "4k3/8/8/8/8/8/3p4/4K3 w - - 0 1 ;e1d2 100",
+    "3rk3/8/8/8/8/8/3P4/4K3 b - - 0 1 ;d8d2 -400",
+    "3qk3/3r4/8/8/8/8/3P4/4K3 b - - 0 1 ;d7d2 100",
+};
+
+struct EpdEntry {
+    std::string fen;
+    std::vector<std::pair<std::string, int>> moves;
+};
+
+static bool parse_epd(const std::string& line, EpdEntry& entry) {
+    const size_t first = line.find(';');
+    entry.fen = line.substr(0, first);
+    entry.fen.erase(entry.fen.find_last_not_of(' ') + 1);
+    entry.moves.clear();
+    if (entry.fen.empty() || first == std::string::npos) return false;
+
+    std::istringstream iss(line.substr(first));
+    std::string field;
+    while (std::getline(iss, field, ';')) {
+        std::istringstream fields(field);
+        std::string move;
+        int value;
+        if (fields >> move >> value) entry.moves.emplace_back(move, value);
+    }
+    return !entry.moves.empty();
+}
+
+static void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n";
+    std::cout << "  --suite <FILE>   - Run an EPD suite instead of the built-in one\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string suite_file;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--suite" && i + 1 < argc) suite_file = argv[++i];
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<std::string> lines;
+    if (!suite_file.empty()) {
+        std::ifstream file(suite_file);
+        if (!file) {
+            std::cerr << "Could not open " << suite_file << std::endl;
+            return 2;
+        }
+        for (std::string line; std::getline(file, line);) lines.push_back(line);
+    } else {
+        lines.assign(std::begin(STANDARD_SUITE), std::end(STANDARD_SUITE));
+    }
+
+    int failures = 0;
+    int run = 0;
+    EpdEntry entry;
+    for (const std::string& line : lines) {
+        if (!parse_epd(line, entry)) continue;
+
+        Board board(entry.fen);
+        const std::vector<Move> legal = board.get_moves();
+        for (const auto& [uci, expected] : entry.moves) {
+            run++;
+            const Move* move = nullptr;
+            for (const Move& m : legal) {
+                if (m.to_uci() == uci) move = &m;
+            }
+            if (!move) {
+                failures++;
+                std::cout << "FAIL " << entry.fen << " " << uci << ": not a legal move" << std::endl;
+                continue;
+            }
+
+            // see_ge takes its own shortcuts, so it has to agree with see on both sides of the value
+            const int value = board.see(*move);
+            std::string mismatch;
+            if (value != expected) mismatch = " expected " + std::to_string(expected);
+            for (const int threshold : {expected - 1, expected, expected + 1}) {
+                if (board.see_ge(*move, threshold) != (value >= threshold)) {
+                    mismatch += " see_ge(" + std::to_string(threshold) + ") disagrees";
+                }
+            }
+            if (!mismatch.empty()) failures++;
+
+            std::cout << (mismatch.empty() ? "ok   " : "FAIL ") << entry.fen << " " << uci << ": " << value
+                      << mismatch << std::endl;
+        }
+    }
+
+    std::cout << run - failures << "/" << run << " passed" << std::endl;
+    return failures ? 1 : 0;
+}
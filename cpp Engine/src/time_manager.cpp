@@ -0,0 +1,24 @@
+#include "time_manager.hpp"
+#include <algorithm>
+
+void TimeManager::init(const SearchLimits& limits, const Turn us) {
+    restart();
+    enabled = !limits.infinite && limits.use_time();
+    fixed_time = limits.movetime > 0;
+    if (!enabled) return;
+
+    if (fixed_time) {
+        optimum_ms = maximum_ms = std::max(1, limits.movetime - MOVE_OVERHEAD_MS);
+        return;
+    }
+
+    // spread the clock over the moves left, spending most of the increment as it comes in
+    const int64_t time_left = std::max(1, limits.time[us] - MOVE_OVERHEAD_MS);
+    const int moves_to_go = limits.movestogo > 0 ? std::min(limits.movestogo, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+    optimum_ms = time_left / moves_to_go + limits.inc[us] * 3 / 4;
+    maximum_ms = std::min<int64_t>(optimum_ms * 4, time_left / 3 + limits.inc[us]);
+
+    // never plan past what is actually on the clock
+    optimum_ms = std::clamp<int64_t>(optimum_ms, 1, time_left);
+    maximum_ms = std::clamp<int64_t>(maximum_ms, optimum_ms, time_left);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "turn.hpp"
+
+/**
+ * @brief The limits of a search, as given by a UCI go command. Zero means no limit.
+ */
+struct SearchLimits {
+    int depth = 0;
+    int movetime = 0;
+    int time[2] = {0, 0};
+    int inc[2] = {0, 0};
+    int movestogo = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+    bool ponder = false;
+
+    /**
+     * @brief Returns if the search is limited by a clock.
+     */
+    constexpr bool use_time() const { return movetime > 0 || time[Turn::WHITE] > 0 || time[Turn::BLACK] > 0; }
+};
+
+class TimeManager {
+/**
+ * @brief Decides how long a search may run.
+ *
+ * The optimum time is the budget for the move; iterative deepening does not start a new
+ * iteration past half of it, since the next one usually takes several times longer than
+ * the last. The maximum time is a hard limit the search polls for and aborts at. A fixed
+ * movetime is spent in full.
+ */
+public:
+    static constexpr int MOVE_OVERHEAD_MS = 30;
+    static constexpr int DEFAULT_MOVES_TO_GO = 30;
+    static constexpr int MAX_MOVES_TO_GO = 50;
+
+    /**
+     * @brief Starts the clock and computes the time budget for the side to move.
+     *
+     * @param limits The limits of the search.
+     * @param us The side to move.
+     */
+    void init(const SearchLimits& limits, const Turn us);
+
+    /**
+     * @brief Restarts the clock without changing the budget, e.g. on a ponder hit.
+     *
+     * Safe to call while another thread is searching.
+     */
+    void restart() { start_ms.store(now_ms(), std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the milliseconds since the clock was started.
+     */
+    int64_t elapsed() const { return now_ms() - start_ms.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns if there is time to start another iteration.
+     */
+    bool can_start_iteration() const { return !enabled || elapsed() < (fixed_time ? maximum_ms : optimum_ms / 2); }
+
+    /**
+     * @brief Returns if the hard time limit has been reached.
+     */
+    bool out_of_time() const { return enabled && elapsed() >= maximum_ms; }
+
+    int64_t optimum() const { return optimum_ms; }
+    int64_t maximum() const { return maximum_ms; }
+
+private:
+    static int64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::atomic<int64_t> start_ms = 0;
+    bool enabled = false;
+    bool fixed_time = false;
+    int64_t optimum_ms = 0;
+    int64_t maximum_ms = 0;
+};
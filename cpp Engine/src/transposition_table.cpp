@@ -0,0 +1,84 @@
+#include "transposition_table.hpp"
+
+TranspositionTable::TranspositionTable(const size_t size_mb) {
+    resize(size_mb);
+}
+
+void TranspositionTable::resize(size_t size_mb) {
+    if (size_mb < 1) size_mb = 1;
+    if (size_mb > MAX_SIZE_MB) size_mb = MAX_SIZE_MB;
+
+    bucket_count = size_mb * 1024 * 1024 / sizeof(Bucket);
+    buckets = std::make_unique<Bucket[]>(bucket_count);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        for (Entry& entry : buckets[i].entries) {
+            entry.key_xor_data.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+bool TranspositionTable::probe(const uint64_t key, TTData& data) const {
+    const Bucket& bucket = buckets[bucket_index(key)];
+    for (const Entry& entry : bucket.entries) {
+        const uint64_t entry_data = entry.data.load(std::memory_order_relaxed);
+        const uint64_t entry_key = entry.key_xor_data.load(std::memory_order_relaxed) ^ entry_data;
+        if (entry_key != key || data_bound(entry_data) == BOUND_NONE) continue;
+
+        data.move = data_move(entry_data);
+        data.score = data_score(entry_data);
+        data.depth = data_depth(entry_data);
+        data.bound = data_bound(entry_data);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(const uint64_t key, const int depth, const int score, const Bound bound, Move move) {
+    Bucket& bucket = buckets[bucket_index(key)];
+
+    // prefer the entry already holding this key, otherwise the shallowest and oldest entry
+    Entry* replace = &bucket.entries[0];
+    int replace_value = INT32_MAX;
+    for (Entry& entry : bucket.entries) {
+        const uint64_t entry_data = entry.data.load(std::memory_order_relaxed);
+        const uint64_t entry_key = entry.key_xor_data.load(std::memory_order_relaxed) ^ entry_data;
+        if (entry_key == key) {
+            // keep a deeper result from this search and the old move if we have none
+            if (bound != BOUND_EXACT && depth < data_depth(entry_data) - 2
+                    && data_generation(entry_data) == generation) {
+                return;
+            }
+            if (move.move == 0) move = data_move(entry_data);
+            replace = &entry;
+            break;
+        }
+        const int age = (generation - data_generation(entry_data)) & GENERATION_MASK;
+        const int value = data_bound(entry_data) == BOUND_NONE ? INT32_MIN : data_depth(entry_data) - 8 * age;
+        if (value < replace_value) {
+            replace_value = value;
+            replace = &entry;
+        }
+    }
+
+    const uint64_t new_data = pack(move, depth, bound, generation, score);
+    replace->data.store(new_data, std::memory_order_relaxed);
+    replace->key_xor_data.store(key ^ new_data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    const size_t sample = bucket_count < 250 ? bucket_count : 250;
+    int used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (const Entry& entry : buckets[i].entries) {
+            const uint64_t entry_data = entry.data.load(std::memory_order_relaxed);
+            if (data_bound(entry_data) != BOUND_NONE && data_generation(entry_data) == generation) used++;
+        }
+    }
+    return sample ? static_cast<int>(used * 1000 / (sample * BUCKET_SIZE)) : 0;
+}
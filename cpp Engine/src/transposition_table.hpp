@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "move.hpp"
+
+enum Bound : uint8_t {
+    BOUND_NONE  = 0,
+    BOUND_UPPER = 1,
+    BOUND_LOWER = 2,
+    BOUND_EXACT = BOUND_UPPER | BOUND_LOWER,
+};
+
+/**
+ * @brief The unpacked contents of a transposition table entry.
+ */
+struct TTData {
+    Move move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+class TranspositionTable {
+/**
+ * @brief A shared hash table of search results, keyed by Zobrist key.
+ *
+ * Entries are grouped in cache-line-sized buckets so a probe touches one line. Each entry is two
+ * 64-bit words: the packed data and the key XOR the data. A reader recomputes key ^ data and
+ * only accepts the entry if it matches the probed key, so a torn write from another thread reads
+ * as a miss instead of corrupt data. No locks are taken on probe or store.
+ */
+public:
+    static constexpr size_t DEFAULT_SIZE_MB = 16;
+    static constexpr size_t MAX_SIZE_MB = 65536;
+
+    /**
+     * @brief Constructs a new TranspositionTable with the given size.
+     *
+     * @param size_mb The table size in megabytes.
+     */
+    TranspositionTable(size_t size_mb = DEFAULT_SIZE_MB);
+
+    /**
+     * @brief Reallocates the table, discarding all entries.
+     *
+     * @param size_mb The table size in megabytes.
+     */
+    void resize(size_t size_mb);
+
+    /**
+     * @brief Empties every entry in the table.
+     */
+    void clear();
+
+    /**
+     * @brief Advances the generation, call once per search so older entries age out.
+     */
+    void new_search() { generation = (generation + 1) & GENERATION_MASK; }
+
+    /**
+     * @brief Looks up a position.
+     *
+     * @param key The Zobrist key of the position.
+     * @param data Filled with the entry's contents on a hit.
+     * @return true if an entry for the key was found.
+     */
+    bool probe(const uint64_t key, TTData& data) const;
+
+    /**
+     * @brief Stores a search result, replacing the least valuable entry in the bucket.
+     *
+     * @param key The Zobrist key of the position.
+     * @param depth The depth the position was searched to.
+     * @param score The score, with mate scores relative to this position.
+     * @param bound Whether the score is exact, a lower bound or an upper bound.
+     * @param move The best move found, or an empty move.
+     */
+    void store(const uint64_t key, const int depth, const int score, const Bound bound, const Move move);
+
+    /**
+     * @brief Estimates how full the table is from a sample of buckets.
+     *
+     * @return The permill of sampled entries written during the current search.
+     */
+    int hashfull() const;
+
+    /**
+     * @brief Hints the CPU to start loading the bucket of a key.
+     */
+    void prefetch(const uint64_t key) const { __builtin_prefetch(&buckets[bucket_index(key)]); }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> key_xor_data;
+        std::atomic<uint64_t> data;
+    };
+
+    static constexpr int BUCKET_SIZE = 4;
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    // data layout: move (16) | depth (8) | bound (2) | generation (6) | score (32)
+    static constexpr uint8_t GENERATION_MASK = 0x3F;
+
+    static constexpr uint64_t pack(const Move move, const int depth, const Bound bound, const uint8_t gen, const int score) {
+        return static_cast<uint64_t>(move.move)
+             | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 16)
+             | (static_cast<uint64_t>(bound) << 24)
+             | (static_cast<uint64_t>(gen) << 26)
+             | (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 32);
+    }
+    static constexpr Move data_move(const uint64_t data) { return Move(static_cast<uint16_t>(data)); }
+    static constexpr int data_depth(const uint64_t data) { return static_cast<int8_t>(data >> 16); }
+    static constexpr Bound data_bound(const uint64_t data) { return static_cast<Bound>((data >> 24) & 0x3); }
+    static constexpr uint8_t data_generation(const uint64_t data) { return (data >> 26) & GENERATION_MASK; }
+    static constexpr int data_score(const uint64_t data) { return static_cast<int32_t>(data >> 32); }
+
+    size_t bucket_index(const uint64_t key) const {
+        return static_cast<size_t>((static_cast<unsigned __int128>(key) * bucket_count) >> 64);
+    }
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucket_count = 0;
+    uint8_t generation = 0;
+};
@@ -0,0 +1,90 @@
+/**
+ * Texel tuner for ChessLi's static evaluation.
+ * Loads a dataset of positions with game results, fits the evaluation weights to it and writes
+ * them as a new eval_weights.hpp. No SFML - rebuild the engine with the written header to use them.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "tuner.hpp"
+
+static void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <DATASET> [OPTIONS]\n";
+    std::cout << "  The dataset is a position file from chessli-pack, or text with a FEN and the result\n";
+    std::cout << "  (1-0, 0-1, 1/2-1/2 or 1.0, 0.5, 0.0) on each line\n";
+    std::cout << "  --epochs <N>     - Passes of gradient descent over the dataset (default: 300)\n";
+    std::cout << "  --rate <X>       - Adam learning rate in centipawns per epoch (default: 1)\n";
+    std::cout << "  --k <X>          - Sigmoid scale, fitted to the dataset when not given\n";
+    std::cout << "  --threads <N>    - Threads to load and evaluate with (default: all cores)\n";
+    std::cout << "  --output <FILE>  - Where to write the tuned weights (default: eval_weights.hpp)\n";
+}
+
+static double seconds_since(const std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::string dataset, output = "eval_weights.hpp";
+    int epochs = 300;
+    double rate = 1.0;
+    double k = 0;
+    int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--epochs" && i + 1 < argc) epochs = std::stoi(argv[++i]);
+        else if (arg == "--rate" && i + 1 < argc) rate = std::stod(argv[++i]);
+        else if (arg == "--k" && i + 1 < argc) k = std::stod(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc) output = argv[++i];
+        else if (dataset.empty() && arg[0] != '-') dataset = arg;
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (dataset.empty()) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    Tuner tuner(threads);
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        tuner.load(dataset);
+        std::cout << "loaded " << tuner.size() << " positions (" << tuner.get_skipped() << " skipped) in "
+                  << std::fixed << std::setprecision(1) << seconds_since(start) << "s, "
+                  << tuner.size() * sizeof(Tuner::Entry) / (1024 * 1024) << " MB" << std::endl;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    if (tuner.size() == 0) {
+        std::cerr << "No positions in " << dataset << std::endl;
+        return 2;
+    }
+
+    Tuner::Weights weights = Tuner::current_weights();
+    if (k <= 0) k = tuner.fit_k(weights);
+    std::cout << "k " << std::setprecision(4) << k << ", starting loss " << std::setprecision(8)
+              << tuner.loss(weights, k) << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    tuner.train(weights, k, epochs, rate, std::cout);
+
+    std::ofstream file(output);
+    if (!file) {
+        std::cerr << "Could not open " << output << std::endl;
+        return 2;
+    }
+    Tuner::write_header(weights, file);
+    std::cout << "wrote " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include "tuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+
+#include "attacks.hpp"
+#include "eval_weights.hpp"
+#include "pawns.hpp"
+#include "position_file.hpp"
+#include "psqt.hpp"
+
+// runs work(thread, begin, end) on each thread's share of count items and waits for all of them
+template <typename Work>
+static void run_threads(const int threads, const size_t count, Work work) {
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(work, t, count * t / threads, count * (t + 1) / threads);
+    }
+    for (auto& thread : pool) thread.join();
+}
+
+// the engine's piece-square and pawn evaluation from white's view, to check the packed terms against
+static int engine_evaluate(const Board& board, PawnTable& pawn_table) {
+    const int score = PSQT::taper(board.psq_pair() + pawn_table.evaluate(board), board.get_phase());
+    return board.get_turn() == Turn::WHITE ? score : -score;
+}
+
+// the same from the packed terms with whole-centipawn weights, rounded the way the engine rounds
+static int packed_evaluate(const Tuner::Entry& entry, const Tuner::Weights& weights) {
+    int mg = 0, eg = 0;
+    int sq, index = 0;
+    CTZLL_ITERATOR(sq, entry.occupied) {
+        const uint8_t nibble = PackedPosition::nibble_at(entry.pieces, index);
+        const int sign = PackedPosition::is_black(nibble) ? -1 : 1;
+        const int piece = PackedPosition::piece_type(nibble);
+        const int relative_sq = sign > 0 ? sq : 63 - sq;
+        const Tuner::Weight& value = weights[Tuner::PIECE_VALUES + piece];
+        const Tuner::Weight& position = weights[Tuner::POSITION_VALUES + piece * 64 + relative_sq];
+        mg += sign * static_cast<int>(value.mg + position.mg);
+        eg += sign * static_cast<int>(value.eg + position.eg);
+        index++;
+    }
+    for (int i = 0; i < Tuner::PAWN_TERM_COUNT; ++i) {
+        mg += entry.pawn_terms[i] * static_cast<int>(weights[Tuner::PAWN_TERMS + i].mg);
+        eg += entry.pawn_terms[i] * static_cast<int>(weights[Tuner::PAWN_TERMS + i].eg);
+    }
+    const int phase = std::min<int>(entry.phase, PSQT::MAX_PHASE);
+    return (mg * phase + eg * (PSQT::MAX_PHASE - phase)) / PSQT::MAX_PHASE;
+}
+
+Tuner::Tuner(const int threads) : threads(std::max(threads, 1)) {}
+
+Tuner::Weights Tuner::current_weights() {
+    Weights weights(WEIGHTS);
+    const auto set = [&](const int index, const int mg, const int eg) {
+        weights[index].mg = mg;
+        weights[index].eg = eg;
+    };
+    for (int piece = 0; piece < 6; ++piece) {
+        set(PIECE_VALUES + piece, EvalWeights::MG_PIECE_VALUES[piece], EvalWeights::EG_PIECE_VALUES[piece]);
+        for (int sq = 0; sq < 64; ++sq) {
+            set(POSITION_VALUES + piece * 64 + sq, EvalWeights::MG_POSITION_VALUES[piece][sq],
+                EvalWeights::EG_POSITION_VALUES[piece][sq]);
+        }
+    }
+    set(DOUBLED_PAWN, EvalWeights::MG_DOUBLED_PAWN, EvalWeights::EG_DOUBLED_PAWN);
+    set(ISOLATED_PAWN, EvalWeights::MG_ISOLATED_PAWN, EvalWeights::EG_ISOLATED_PAWN);
+    set(BACKWARD_PAWN, EvalWeights::MG_BACKWARD_PAWN, EvalWeights::EG_BACKWARD_PAWN);
+    for (int rank = 0; rank < 8; ++rank) {
+        set(PASSED_PAWN + rank, EvalWeights::MG_PASSED_PAWN[rank], EvalWeights::EG_PASSED_PAWN[rank]);
+        set(FREE_PASSED_PAWN + rank, EvalWeights::MG_FREE_PASSED_PAWN[rank], EvalWeights::EG_FREE_PASSED_PAWN[rank]);
+    }
+    for (int distance = 0; distance < 2; ++distance) {
+        set(PAWN_SHELTER + distance, EvalWeights::MG_PAWN_SHELTER[distance], EvalWeights::EG_PAWN_SHELTER[distance]);
+    }
+    set(SHELTER_MISSING, EvalWeights::MG_SHELTER_MISSING, EvalWeights::EG_SHELTER_MISSING);
+    return weights;
+}
+
+void Tuner::pack(const Board& board, const int result, Entry& entry) {
+    // the pieces are laid out as in a PackedPosition
+    const PackedPosition record = board.pack();
+    entry = Entry{};
+    entry.occupied = record.occupied;
+    std::copy(std::begin(record.pieces), std::end(record.pieces), entry.pieces);
+    entry.phase = static_cast<uint8_t>(board.get_phase());
+    entry.result = static_cast<uint8_t>(result);
+
+    int sq;
+
+    // the terms PawnTable scores, counted instead of weighted
+    const auto count = [&](const int term, const int sign) { entry.pawn_terms[term - PAWN_TERMS] += sign; };
+    for (int color = 0; color < 2; ++color) {
+        const Turn side = static_cast<Turn>(color);
+        const int sign = side == Turn::WHITE ? 1 : -1;
+        const Bitboard own_pawns = board.get_pieces(side, Piece::PAWN);
+        const Bitboard enemy_pawns = board.get_pieces(static_cast<Turn>(!side), Piece::PAWN);
+
+        CTZLL_ITERATOR(sq, own_pawns) {
+            const int relative_rank = side == Turn::WHITE ? sq / 8 : 7 - sq / 8;
+            const bool doubled = PawnTable::forward_file[side][sq] & own_pawns;
+            if (doubled) count(DOUBLED_PAWN, sign);
+            if (!(PawnTable::adjacent_files[sq % 8] & own_pawns)) {
+                count(ISOLATED_PAWN, sign);
+            } else if (!(PawnTable::support_span[side][sq] & own_pawns)) {
+                const int stop = side == Turn::WHITE ? sq + 8 : sq - 8;
+                if (AttackBitboards::pawn_attacks[side][stop] & enemy_pawns) count(BACKWARD_PAWN, sign);
+            }
+            if (!doubled && !(PawnTable::passed_span[side][sq] & enemy_pawns)) {
+                count(PASSED_PAWN + relative_rank, sign);
+                if (!(PawnTable::forward_file[side][sq] & board.get_occupied())) {
+                    count(FREE_PASSED_PAWN + relative_rank, sign);
+                }
+            }
+        }
+
+        const int king_sq = __builtin_ctzll(board.get_pieces(side, Piece::KING));
+        const int king_file = king_sq % 8;
+        for (int file = std::max(king_file - 1, 0); file <= std::min(king_file + 1, 7); ++file) {
+            int term = SHELTER_MISSING;
+            for (int distance = 2; distance >= 1; --distance) {
+                const int rank = king_sq / 8 + sign * distance;
+                if (rank >= 0 && rank <= 7 && own_pawns.covers(rank * 8 + file)) term = PAWN_SHELTER + distance - 1;
+            }
+            count(term, sign);
+        }
+    }
+}
+
+double Tuner::evaluate(const Entry& entry, const Weights& weights) {
+    double mg = 0, eg = 0;
+    int sq, index = 0;
+    CTZLL_ITERATOR(sq, entry.occupied) {
+        const uint8_t nibble = PackedPosition::nibble_at(entry.pieces, index);
+        const double sign = PackedPosition::is_black(nibble) ? -1 : 1;
+        const int piece = PackedPosition::piece_type(nibble);
+        const Weight& value = weights[PIECE_VALUES + piece];
+        const Weight& position = weights[POSITION_VALUES + piece * 64 + (sign > 0 ? sq : 63 - sq)];
+        mg += sign * (value.mg + position.mg);
+        eg += sign * (value.eg + position.eg);
+        index++;
+    }
+    for (int i = 0; i < PAWN_TERM_COUNT; ++i) {
+        mg += entry.pawn_terms[i] * weights[PAWN_TERMS + i].mg;
+        eg += entry.pawn_terms[i] * weights[PAWN_TERMS + i].eg;
+    }
+    const int phase = std::min<int>(entry.phase, PSQT::MAX_PHASE);
+    return (mg * phase + eg * (PSQT::MAX_PHASE - phase)) / PSQT::MAX_PHASE;
+}
+
+size_t Tuner::load(const std::string& path) {
+    const size_t before = entries.size();
+
+    // packed records are read in place, text is parsed a batch of lines at a time
+    if (PositionReader::is_position_file(path)) {
+        const PositionReader reader(path);
+        for (size_t first = 0; first < reader.size(); first += LOAD_BATCH) {
+            const size_t count = std::min(LOAD_BATCH, reader.size() - first);
+            pack_batch(count, [&](const size_t i, Board& board, int& result) {
+                const PackedPosition& record = reader[first + i];
+                if (record.result > 2) return false;
+                board.set_packed(record);
+                result = record.result;
+                return true;
+            });
+        }
+        return entries.size() - before;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Can't open dataset " + path);
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (file) {
+        lines.clear();
+        while (lines.size() < LOAD_BATCH && std::getline(file, line)) {
+            if (!line.empty() && line[0] != '#') lines.push_back(std::move(line));
+        }
+        pack_batch(lines.size(), [&](const size_t i, Board& board, int& result) {
+            PositionText text;
+            if (!PositionText::parse(lines[i], text) || text.result > 2) return false;
+            board.set_fen(text.fen);
+            result = text.result;
+            return true;
+        });
+    }
+    return entries.size() - before;
+}
+
+template <typename Load>
+void Tuner::pack_batch(const size_t count, Load load) {
+    const Weights weights = current_weights();
+    std::vector<std::vector<Entry>> packed(threads);
+    std::vector<size_t> thread_skipped(threads);
+    std::vector<std::string> mismatches(threads);
+
+    run_threads(threads, count, [&](const int t, const size_t begin, const size_t end) {
+        Board board;
+        PawnTable pawn_table;
+        int result;
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                if (!load(i, board, result)) throw std::runtime_error("No position with a result");
+            } catch (const std::runtime_error&) {
+                thread_skipped[t]++;
+                continue;
+            }
+            if (!board.get_pieces(Turn::WHITE, Piece::KING) || !board.get_pieces(Turn::BLACK, Piece::KING)
+                || __builtin_popcountll(board.get_occupied()) > 32) {
+                thread_skipped[t]++;
+                continue;
+            }
+
+            Entry entry;
+            pack(board, result, entry);
+            if (mismatches[t].empty() && packed_evaluate(entry, weights) != engine_evaluate(board, pawn_table)) {
+                mismatches[t] = board.get_fen();
+            }
+            packed[t].push_back(entry);
+        }
+    });
+
+    for (int t = 0; t < threads; ++t) {
+        if (!mismatches[t].empty()) {
+            throw std::runtime_error("Tuner and engine evaluate differently at " + mismatches[t]);
+        }
+        entries.insert(entries.end(), packed[t].begin(), packed[t].end());
+        skipped += thread_skipped[t];
+    }
+}
+
+double Tuner::sigmoid(const double eval, const double k) {
+    return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+}
+
+double Tuner::error_sum(const Weights& weights, const double k, const size_t begin, const size_t end) const {
+    double sum = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const double error = entries[i].result / 2.0 - sigmoid(evaluate(entries[i], weights), k);
+        sum += error * error;
+    }
+    return sum;
+}
+
+double Tuner::loss(const Weights& weights, const double k) const {
+    std::vector<double> sums(threads);
+    run_threads(threads, entries.size(), [&](const int t, const size_t begin, const size_t end) {
+        sums[t] = error_sum(weights, k, begin, end);
+    });
+    double sum = 0;
+    for (const double thread_sum : sums) sum += thread_sum;
+    return sum / std::max<size_t>(entries.size(), 1);
+}
+
+double Tuner::fit_k(const Weights& weights) const {
+    // golden section search, the loss has a single minimum in k
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0.05, high = 5.0;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double loss_a = loss(weights, a), loss_b = loss(weights, b);
+    while (high - low > 1e-4) {
+        if (loss_a < loss_b) {
+            high = b;
+            b = a;
+            loss_b = loss_a;
+            a = high - ratio * (high - low);
+            loss_a = loss(weights, a);
+        } else {
+            low = a;
+            a = b;
+            loss_a = loss_b;
+            b = low + ratio * (high - low);
+            loss_b = loss(weights, b);
+        }
+    }
+    return (low + high) / 2;
+}
+
+void Tuner::accumulate_gradient(const Weights& weights, const double k, const size_t begin, const size_t end,
+                                Weights& gradient) const {
+    for (size_t i = begin; i < end; ++i) {
+        const Entry& entry = entries[i];
+        const double expected = sigmoid(evaluate(entry, weights), k);
+        // d(error^2)/d(eval) up to the constant factor 2 * ln(10) * k / 400, applied once at the end
+        const double slope = (expected - entry.result / 2.0) * expected * (1 - expected);
+        const int phase = std::min<int>(entry.phase, PSQT::MAX_PHASE);
+        const double mg_slope = slope * phase / PSQT::MAX_PHASE;
+        const double eg_slope = slope * (PSQT::MAX_PHASE - phase) / PSQT::MAX_PHASE;
+
+        int sq, index = 0;
+        CTZLL_ITERATOR(sq, entry.occupied) {
+            const uint8_t nibble = PackedPosition::nibble_at(entry.pieces, index);
+            const double sign = PackedPosition::is_black(nibble) ? -1 : 1;
+            const int piece = PackedPosition::piece_type(nibble);
+            Weight& value = gradient[PIECE_VALUES + piece];
+            Weight& position = gradient[POSITION_VALUES + piece * 64 + (sign > 0 ? sq : 63 - sq)];
+            value.mg += sign * mg_slope;
+            value.eg += sign * eg_slope;
+            position.mg += sign * mg_slope;
+            position.eg += sign * eg_slope;
+            index++;
+        }
+        for (int term = 0; term < PAWN_TERM_COUNT; ++term) {
+            if (!entry.pawn_terms[term]) continue;
+            gradient[PAWN_TERMS + term].mg += entry.pawn_terms[term] * mg_slope;
+            gradient[PAWN_TERMS + term].eg += entry.pawn_terms[term] * eg_slope;
+        }
+    }
+}
+
+void Tuner::train(Weights& weights, const double k, const int epochs, const double learning_rate,
+                  std::ostream& log) const {
+    constexpr double BETA1 = 0.9, BETA2 = 0.999, EPSILON = 1e-8;
+    Weights momentum(WEIGHTS), velocity(WEIGHTS);
+    std::vector<Weights> gradients(threads, Weights(WEIGHTS));
+    const double scale = 2 * std::log(10.0) * k / 400 / std::max<size_t>(entries.size(), 1);
+    const int log_interval = std::max(epochs / 20, 1);
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        run_threads(threads, entries.size(), [&](const int t, const size_t begin, const size_t end) {
+            std::fill(gradients[t].begin(), gradients[t].end(), Weight{});
+            accumulate_gradient(weights, k, begin, end, gradients[t]);
+        });
+
+        const double correction1 = 1 - std::pow(BETA1, epoch);
+        const double correction2 = 1 - std::pow(BETA2, epoch);
+        const auto step = [&](double& weight, double& m, double& v, const double gradient) {
+            m = BETA1 * m + (1 - BETA1) * gradient;
+            v = BETA2 * v + (1 - BETA2) * gradient * gradient;
+            weight -= learning_rate * (m / correction1) / (std::sqrt(v / correction2) + EPSILON);
+        };
+        for (int i = 0; i < WEIGHTS; ++i) {
+            double mg = 0, eg = 0;
+            for (const Weights& gradient : gradients) {
+                mg += gradient[i].mg;
+                eg += gradient[i].eg;
+            }
+            step(weights[i].mg, momentum[i].mg, velocity[i].mg, mg * scale);
+            step(weights[i].eg, momentum[i].eg, velocity[i].eg, eg * scale);
+        }
+
+        if (epoch % log_interval == 0 || epoch == epochs) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            log << "epoch " << epoch << " loss " << std::setprecision(8) << loss(weights, k)
+                << " (" << std::setprecision(3) << seconds << "s)" << std::endl;
+        }
+    }
+}
+
+void Tuner::write_header(const Weights& weights, std::ostream& out) {
+    const auto mg = [&](const int index) { return std::lround(weights[index].mg); };
+    const auto eg = [&](const int index) { return std::lround(weights[index].eg); };
+    const auto scalar = [&](const char* name, const int index) {
+        out << "    static constexpr int MG_" << name << " = " << mg(index) << ";\n";
+        out << "    static constexpr int EG_" << name << " = " << eg(index) << ";\n";
+    };
+    const auto list = [&](const char* name, const int index, const int size) {
+        for (const char* phase : {"MG", "EG"}) {
+            out << "    static constexpr int " << phase << "_" << name << "[" << size << "] = {";
+            for (int i = 0; i < size; ++i) {
+                out << (i ? ", " : "") << (phase[0] == 'M' ? mg(index + i) : eg(index + i));
+            }
+            out << "};\n";
+        }
+    };
+    const auto table = [&](const char* name, const int index) {
+        for (const char* phase : {"MG", "EG"}) {
+            out << "    static constexpr int " << phase << "_" << name << "[6][64] = {\n";
+            for (int piece = 0; piece < 6; ++piece) {
+                out << "        {\n";
+                for (int rank = 0; rank < 8; ++rank) {
+                    out << "            ";
+                    for (int file = 0; file < 8; ++file) {
+                        const int i = index + piece * 64 + rank * 8 + file;
+                        out << std::setw(4) << (phase[0] == 'M' ? mg(i) : eg(i)) << ",";
+                    }
+                    out << "\n";
+                }
+                out << "        },\n";
+            }
+            out << "    };\n";
+            if (phase[0] == 'M') out << "\n";
+        }
+    };
+
+    out << "#pragma once\n\n";
+    out << "// Generated by chessli-tune from a dataset of scored positions; hand edits are fine too, the\n";
+    out << "// tuner starts from whatever is here.\n";
+    out << "struct EvalWeights {\n";
+    out << "/**\n";
+    out << " * @brief Every weight of the static evaluation, a middlegame and an endgame value each.\n";
+    out << " *\n";
+    out << " * Tables are laid out from white's side with A1 first. PSQT packs the material and\n";
+    out << " * piece-square weights, PawnTable the pawn structure ones.\n";
+    out << " */\n";
+    list("PIECE_VALUES", PIECE_VALUES, 6);
+    out << "\n";
+    table("POSITION_VALUES", POSITION_VALUES);
+    out << "\n";
+    out << "    // pawn structure, per pawn from its own side's view\n";
+    scalar("DOUBLED_PAWN", DOUBLED_PAWN);
+    scalar("ISOLATED_PAWN", ISOLATED_PAWN);
+    scalar("BACKWARD_PAWN", BACKWARD_PAWN);
+    out << "\n";
+    out << "    // by the rank of the pawn from its own side, then more for a passed pawn whose path is clear\n";
+    list("PASSED_PAWN", PASSED_PAWN, 8);
+    list("FREE_PASSED_PAWN", FREE_PASSED_PAWN, 8);
+    out << "\n";
+    out << "    // per file around the king: an own pawn one or two ranks in front of it, or none on the file\n";
+    list("PAWN_SHELTER", PAWN_SHELTER, 2);
+    scalar("SHELTER_MISSING", SHELTER_MISSING);
+    out << "};\n";
+}
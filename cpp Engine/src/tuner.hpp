@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+class Tuner {
+/**
+ * @brief Texel tuning of the static evaluation weights against game results.
+ *
+ * The piece-square and pawn structure evaluation is linear in its weights: each weight adds its
+ * middlegame and endgame value once per occurrence of its term, and the two sums are tapered by
+ * the phase. So every position is packed once into an Entry holding its board and its pawn
+ * term counts, and each epoch re-evaluates all of them from the weight vector. The weights
+ * minimize the mean squared error between the results and sigmoid(K * eval), full batch with
+ * Adam, each thread taking its own slice of the dataset.
+ */
+public:
+    // where each group of weights starts in the weight vector, in the order of eval_weights.hpp
+    static constexpr int PIECE_VALUES = 0;
+    static constexpr int POSITION_VALUES = PIECE_VALUES + 6;
+    static constexpr int PAWN_TERMS = POSITION_VALUES + 6 * 64;
+    static constexpr int DOUBLED_PAWN = PAWN_TERMS;
+    static constexpr int ISOLATED_PAWN = DOUBLED_PAWN + 1;
+    static constexpr int BACKWARD_PAWN = ISOLATED_PAWN + 1;
+    static constexpr int PASSED_PAWN = BACKWARD_PAWN + 1;
+    static constexpr int FREE_PASSED_PAWN = PASSED_PAWN + 8;
+    static constexpr int PAWN_SHELTER = FREE_PASSED_PAWN + 8;
+    static constexpr int SHELTER_MISSING = PAWN_SHELTER + 2;
+    static constexpr int WEIGHTS = SHELTER_MISSING + 1;
+    static constexpr int PAWN_TERM_COUNT = WEIGHTS - PAWN_TERMS;
+
+    struct Weight {
+        double mg = 0;
+        double eg = 0;
+    };
+    using Weights = std::vector<Weight>;
+
+    /**
+     * @brief A training position packed into 48 bytes, enough to evaluate it under any weights.
+     */
+    struct Entry {
+        // the pieces as a PackedPosition holds them
+        uint64_t occupied;
+        uint8_t pieces[16];
+        // how often each pawn structure term occurs for white minus for black
+        int8_t pawn_terms[PAWN_TERM_COUNT];
+        uint8_t phase;
+        // the game result for white in half points
+        uint8_t result;
+    };
+
+    /**
+     * @brief Constructs a new Tuner.
+     *
+     * @param threads The number of threads that load and evaluate the dataset.
+     */
+    explicit Tuner(int threads);
+
+    /**
+     * @brief Loads a dataset: a file written by PositionWriter, or text with one position per
+     * line as PositionText reads it.
+     *
+     * Positions without a result, and lines that don't parse, are counted and skipped.
+     *
+     * @param path The dataset file.
+     * @return The number of positions loaded from it.
+     * @throws std::runtime_error if the file can't be read, or if a position evaluates
+     * differently here than in the engine, which means the two have drifted apart.
+     */
+    size_t load(const std::string& path);
+
+    size_t size() const { return entries.size(); }
+    size_t get_skipped() const { return skipped; }
+
+    /**
+     * @brief Returns the weights the engine is built with, from eval_weights.hpp.
+     */
+    static Weights current_weights();
+
+    /**
+     * @brief Packs a position for training.
+     *
+     * @param board The position.
+     * @param result The game result for white in half points: 0, 1 or 2.
+     * @param entry Filled with the packed position.
+     */
+    static void pack(const Board& board, int result, Entry& entry);
+
+    /**
+     * @brief Evaluates a packed position from white's view, like the engine but without rounding.
+     */
+    static double evaluate(const Entry& entry, const Weights& weights);
+
+    /**
+     * @brief Returns the mean squared error of the weights over the dataset.
+     *
+     * @param weights The weights to evaluate with.
+     * @param k The scale of the sigmoid turning centipawns into an expected result.
+     */
+    double loss(const Weights& weights, double k) const;
+
+    /**
+     * @brief Finds the sigmoid scale that fits the dataset best under the given weights.
+     */
+    double fit_k(const Weights& weights) const;
+
+    /**
+     * @brief Runs gradient descent on the weights.
+     *
+     * @param weights The starting weights, replaced by the tuned ones.
+     * @param k The sigmoid scale.
+     * @param epochs How many passes over the dataset to make.
+     * @param learning_rate How far Adam may move a weight per epoch, in centipawns.
+     * @param log Where the loss is reported as training goes.
+     */
+    void train(Weights& weights, double k, int epochs, double learning_rate, std::ostream& log) const;
+
+    /**
+     * @brief Writes weights as an eval_weights.hpp, rounded to whole centipawns.
+     */
+    static void write_header(const Weights& weights, std::ostream& out);
+
+private:
+    // the positions are read this many at a time, then packed in parallel
+    static constexpr size_t LOAD_BATCH = 1 << 20;
+
+    // packs count positions in parallel; load(i, board, result) sets up the i-th or returns false
+    template <typename Load>
+    void pack_batch(size_t count, Load load);
+    static double sigmoid(double eval, double k);
+    // the gradient of the loss over the entries in [begin, end), not yet divided by their count
+    void accumulate_gradient(const Weights& weights, double k, size_t begin, size_t end, Weights& gradient) const;
+    double error_sum(const Weights& weights, double k, size_t begin, size_t end) const;
+
+    std::vector<Entry> entries;
+    size_t skipped = 0;
+    int threads;
+};
@@ -4,22 +4,110 @@
  * No SFML or GUI - standalone engine process.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 
 #include "board.hpp"
 #include "engine.hpp"
+#include "bench.hpp"
+#include "nnue.hpp"
 
 static Board board;
 static Engine engine(&board);
 
+static void print_info(const SearchInfo& info) {
+    // info depth D seldepth S [multipv 1 score cp|mate X] nodes N nps N hashfull H time T [currmove M currmovenumber K] [pv ...]
+    std::ostringstream out;
+    out << "info depth " << info.depth << " seldepth " << info.seldepth;
+    if (!info.pv.empty()) {
+        out << " multipv 1 score ";
+        if (info.mate_in) out << "mate " << info.mate_in;
+        else out << "cp " << info.score;
+    }
+    out << " nodes " << info.nodes << " nps " << info.nps << " hashfull " << info.hashfull << " time " << info.time;
+    if (info.currmove.move) out << " currmove " << info.currmove.to_uci() << " currmovenumber " << info.currmove_number;
+    if (!info.pv.empty()) {
+        out << " pv";
+        for (const Move& move : info.pv) out << ' ' << move.to_uci();
+    }
+    std::cout << out.str() << std::endl;
+}
+
 static void cmd_uci() {
     std::cout << "id name ChessLi" << std::endl;
     std::cout << "id author Pr0ph3t" << std::endl;
+    std::cout << "option name Hash type spin default " << TranspositionTable::DEFAULT_SIZE_MB
+              << " min 1 max " << TranspositionTable::MAX_SIZE_MB << std::endl;
+    std::cout << "option name Threads type spin default 1 min 1 max " << Engine::MAX_THREADS << std::endl;
+    std::cout << "option name Ponder type check default false" << std::endl;
+    std::cout << "option name EvalFile type string default <empty>" << std::endl;
+    const SearchOptions defaults;
+    std::cout << std::boolalpha;
+    std::cout << "option name NullMove type check default " << defaults.null_move << std::endl;
+    std::cout << "option name LMR type check default " << defaults.late_move_reductions << std::endl;
+    std::cout << "option name ReverseFutility type check default " << defaults.reverse_futility << std::endl;
+    std::cout << "option name Futility type check default " << defaults.futility << std::endl;
+    std::cout << std::noboolalpha;
     std::cout << "uciok" << std::endl;
 }
 
+static void cmd_setoption(const std::string& line) {
+    // setoption name <id> [value <x>]
+    std::istringstream iss(line);
+    std::string token, name, value;
+    iss >> token;  // "setoption"
+    iss >> token;  // "name"
+    while (iss >> token && token != "value") {
+        if (!name.empty()) name += ' ';
+        name += token;
+    }
+    while (iss >> token) {
+        if (!value.empty()) value += ' ';
+        value += token;
+    }
+
+    if (name == "Hash") {
+        try {
+            engine.set_hash_size(std::stoul(value));
+        } catch (const std::exception&) {
+            std::cout << "info string invalid Hash value " << value << std::endl;
+        }
+    } else if (name == "Threads") {
+        try {
+            engine.set_threads(std::stoi(value));
+        } catch (const std::exception&) {
+            std::cout << "info string invalid Threads value " << value << std::endl;
+        }
+    } else if (name == "EvalFile") {
+        if (value.empty() || value == "<empty>") {
+            NNUE::unload();
+            std::cout << "info string using the piece-square evaluation" << std::endl;
+            return;
+        }
+        try {
+            NNUE::load(value);
+            std::cout << "info string loaded network " << value << std::endl;
+        } catch (const std::exception& e) {
+            NNUE::unload();
+            std::cout << "info string " << e.what() << ", using the piece-square evaluation" << std::endl;
+        }
+    } else if (name == "NullMove" || name == "LMR" || name == "ReverseFutility" || name == "Futility") {
+        if (value != "true" && value != "false") {
+            std::cout << "info string invalid " << name << " value " << value << std::endl;
+            return;
+        }
+        SearchOptions options = engine.get_search_options();
+        bool& option = name == "NullMove" ? options.null_move
+                     : name == "LMR" ? options.late_move_reductions
+                     : name == "ReverseFutility" ? options.reverse_futility
+                     : options.futility;
+        option = value == "true";
+        engine.set_search_options(options);
+    }
+}
+
 static void cmd_isready() {
     std::cout << "readyok" << std::endl;
 }
@@ -64,29 +152,58 @@ static void cmd_position(const std::string& line) {
             }
         }
         if (!to_apply) break;
+        // the search needs the rest of the ply stack
+        if (board.get_ply_count() >= Board::MAX_GAME_PLIES) break;
         board.make_move(to_apply);
     }
 }
 
 static void cmd_go(const std::string& line) {
-    // go depth N
-    int depth = Engine::DEFAULT_DEPTH;
+    // go [ponder] [depth N] [wtime N] [btime N] [winc N] [binc N] [movestogo N] [movetime N] [nodes N] [infinite]
+    SearchLimits limits;
     std::istringstream iss(line);
     std::string token;
+    iss >> token;  // "go"
     while (iss >> token) {
-        if (token == "depth" && iss >> depth) break;
+        if (token == "depth") iss >> limits.depth;
+        else if (token == "wtime") iss >> limits.time[Turn::WHITE];
+        else if (token == "btime") iss >> limits.time[Turn::BLACK];
+        else if (token == "winc") iss >> limits.inc[Turn::WHITE];
+        else if (token == "binc") iss >> limits.inc[Turn::BLACK];
+        else if (token == "movestogo") iss >> limits.movestogo;
+        else if (token == "movetime") iss >> limits.movetime;
+        else if (token == "nodes") iss >> limits.nodes;
+        else if (token == "infinite") limits.infinite = true;
+        else if (token == "ponder") limits.ponder = true;
     }
-    if (depth < 1) depth = 1;
-    if (depth > Engine::MAX_DEPTH) depth = Engine::MAX_DEPTH;
+    if (limits.depth < 0) limits.depth = 0;
+    if (limits.depth > Engine::MAX_DEPTH) limits.depth = Engine::MAX_DEPTH;
 
-    auto moves = board.get_moves();
-    if (moves.empty()) {
-        std::cout << "bestmove (none)" << std::endl;
-        return;
+    // a bare "go" keeps the old fixed-depth behaviour
+    if (!limits.depth && !limits.use_time() && !limits.nodes && !limits.infinite) {
+        limits.depth = Engine::DEFAULT_DEPTH;
     }
 
-    Move best = engine.get_best_move(depth);
-    std::cout << "bestmove " << best.to_uci() << std::endl;
+    // the search runs on its own thread so stop, ponderhit and isready are answered meanwhile
+    engine.think_async(limits, [](Move best, Move ponder) {
+        const uint64_t nodes = engine.get_nodes();
+        const int64_t elapsed = engine.get_elapsed();
+        std::ostringstream out;
+        out << "info nodes " << nodes << " nps " << nodes * 1000 / std::max<int64_t>(elapsed, 1)
+            << " time " << elapsed << "\n";
+        out << "info string qnodes " << engine.get_qnodes()
+            << " (" << engine.get_qnodes() * 100 / std::max<uint64_t>(nodes, 1) << "%)\n";
+        out << "info string pawn hash hits " << engine.get_pawn_hits() << "/" << engine.get_pawn_probes()
+            << " (" << engine.get_pawn_hits() * 100 / std::max<uint64_t>(engine.get_pawn_probes(), 1) << "%)\n";
+        out << "bestmove " << (best.move ? best.to_uci() : "(none)");
+        if (ponder.move) out << " ponder " << ponder.to_uci();
+        std::cout << out.str() << std::endl;
+    });
+}
+
+static void stop_search() {
+    engine.stop();
+    engine.wait();
 }
 
 static void cmd_undo(const std::string& line) {
@@ -110,6 +227,31 @@ static void cmd_getfen() {
     std::cout << "fen " << board.get_fen() << std::endl;
 }
 
+static void cmd_bench(const std::string& line) {
+    // bench [depth] | bench makemove [depth] | bench eval [depth]
+    std::istringstream iss(line);
+    std::string token;
+    iss >> token;  // "bench"
+    if (iss >> token && token == "makemove") {
+        int depth = Bench::MAKE_MOVE_DEPTH;
+        iss >> depth;
+        Bench::make_move_modes(std::clamp(depth, 1, Engine::MAX_DEPTH));
+        return;
+    }
+    if (token == "eval") {
+        int depth = Bench::EVAL_DEPTH;
+        iss >> depth;
+        Bench::eval_backends(std::clamp(depth, 1, Engine::MAX_DEPTH));
+        return;
+    }
+
+    int depth = Bench::DEFAULT_DEPTH;
+    try {
+        depth = std::stoi(token);
+    } catch (const std::exception&) {}
+    Bench::thread_scaling(std::clamp(depth, 1, Engine::MAX_DEPTH));
+}
+
 int main(int argc, char* argv[]) {
     // Check for --uci flag (optional; if no args, assume UCI mode for subprocess use)
     bool uci_mode = (argc <= 1);
@@ -126,6 +268,7 @@ int main(int argc, char* argv[]) {
     }
 
     board.set_fen(Board::STARTING_BOARD);
+    engine.set_info_callback(print_info);
 
     std::string line;
     while (std::getline(std::cin, line)) {
@@ -135,24 +278,38 @@ int main(int argc, char* argv[]) {
         std::string cmd;
         iss >> cmd;
 
+        // anything touching the board or the engine state waits for the search to end first
+        if (cmd != "isready" && cmd != "stop" && cmd != "ponderhit" && cmd != "uci") {
+            stop_search();
+        }
+
         if (cmd == "uci") {
             cmd_uci();
         } else if (cmd == "isready") {
             cmd_isready();
+        } else if (cmd == "setoption") {
+            cmd_setoption(line);
+        } else if (cmd == "ucinewgame") {
+            engine.new_game();
         } else if (cmd == "position") {
             cmd_position(line);
         } else if (cmd == "go") {
             cmd_go(line);
         } else if (cmd == "stop") {
-            // We don't support pondering; ignore
+            stop_search();
+        } else if (cmd == "ponderhit") {
+            engine.ponderhit();
         } else if (cmd == "quit") {
             break;
         } else if (cmd == "undo") {
             cmd_undo(line);
         } else if (cmd == "getfen") {
             cmd_getfen();
+        } else if (cmd == "bench") {
+            cmd_bench(line);
         }
     }
 
+    stop_search();
     return 0;
 }
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+struct Zobrist {
+/**
+ * @brief Random keys for Zobrist hashing of positions.
+ *
+ * A position key is the XOR of one key per piece on its square, the key of the castling rights,
+ * the key of the en passant file if a pawn of the side to move can capture en passant, and the
+ * side key if black is to move. Keys come from a fixed-seed generator so hashes are stable across runs.
+ */
+    static inline uint64_t pieces[2][6][64];
+    static inline uint64_t castling[16];
+    static inline uint64_t en_passant[8];
+    static inline uint64_t side;
+
+    static void init() {
+        uint64_t seed = 0x3243F6A8885A308DULL;
+        auto random = [&seed]() {
+            seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+            return seed * 0x2545F4914F6CDD1DULL;
+        };
+
+        for (int color = 0; color < 2; ++color) {
+            for (int piece = 0; piece < 6; ++piece) {
+                for (int sq = 0; sq < 64; ++sq) {
+                    pieces[color][piece][sq] = random();
+                }
+            }
+        }
+
+        // each combination of rights is the XOR of its individual rights
+        uint64_t rights[4];
+        for (auto& key : rights) key = random();
+        for (int r = 0; r < 16; ++r) {
+            castling[r] = 0;
+            for (int bit = 0; bit < 4; ++bit) {
+                if (r & (1 << bit)) castling[r] ^= rights[bit];
+            }
+        }
+
+        for (auto& key : en_passant) key = random();
+        side = random();
+    }
+};
+
+inline const auto _zobrist_initializer = []() {
+    Zobrist::init();
+    return true;
+}();